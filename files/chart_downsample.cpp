@@ -0,0 +1,62 @@
+#include <Arduino.h>
+#include "chart_downsample.h"
+
+// First point of bucket, the points between the first and the last are split into threshold - 2 buckets
+static size_t bucket_start(size_t bucket, size_t count, size_t threshold)
+{
+    return 1 + bucket * (count - 2) / (threshold - 2);
+}
+
+size_t lttb_downsample(size_t count, size_t threshold, chart_point_value_fn value, const void *context, uint16_t *selected)
+{
+    if (count <= threshold || threshold < 3)
+    {
+        size_t picked = min(count, threshold);
+        for (size_t i = 0; i < picked; i++)
+        {
+            selected[i] = i;
+        }
+        return picked;
+    }
+
+    size_t picked = 0;
+    selected[picked++] = 0;
+    int64_t a_x = 0;
+    int64_t a_y = value(context, 0);
+    for (size_t bucket = 0; bucket < threshold - 2; bucket++)
+    {
+        // The third corner is the average of the next bucket, kept as sums so the math stays exact
+        size_t next_start = bucket_start(bucket + 1, count, threshold);
+        size_t next_end = bucket + 1 < threshold - 2 ? bucket_start(bucket + 2, count, threshold) : count;
+        int64_t next_points = next_end - next_start;
+        int64_t sum_x = 0;
+        int64_t sum_y = 0;
+        for (size_t i = next_start; i < next_end; i++)
+        {
+            sum_x += i;
+            sum_y += value(context, i);
+        }
+
+        // Twice the triangle area times next_points, the factor is the same for the whole bucket
+        int64_t max_area = -1;
+        size_t max_index = 0;
+        int64_t max_y = 0;
+        for (size_t i = bucket_start(bucket, count, threshold); i < next_start; i++)
+        {
+            int64_t b_y = value(context, i);
+            int64_t area = (a_x * next_points - sum_x) * (b_y - a_y) - (a_x - (int64_t)i) * (sum_y - a_y * next_points);
+            area = area < 0 ? -area : area;
+            if (area > max_area)
+            {
+                max_area = area;
+                max_index = i;
+                max_y = b_y;
+            }
+        }
+        selected[picked++] = max_index;
+        a_x = max_index;
+        a_y = max_y;
+    }
+    selected[picked++] = count - 1;
+    return picked;
+}
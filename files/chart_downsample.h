@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Reads the y value of point index, x is the index itself
+typedef int32_t (*chart_point_value_fn)(const void *context, size_t index);
+
+// Largest-Triangle-Three-Buckets: picks threshold of the count points that keep the visual shape of the
+// line, always including the first and the last. Writes the picked indices in order to selected, which
+// holds threshold entries, and returns how many were written. With count <= threshold every point is
+// picked. Integer math only, the cost is one pass over the points.
+size_t lttb_downsample(size_t count, size_t threshold, chart_point_value_fn value, const void *context, uint16_t *selected);
@@ -0,0 +1,76 @@
+#include <Arduino.h>
+#include <esp_sntp.h>
+#include <sys/time.h>
+#include "clock_sync.h"
+#include "utils.h"
+
+static LilyGo_Class *clock_sync_board = nullptr;
+static void (*clock_sync_on_synced)(void) = nullptr;
+static volatile bool rtc_write_pending = false;
+static time_t sntp_time = 0;
+static uint32_t sntp_time_received_ms = 0;
+
+bool clock_sync_begin(LilyGo_Class *board)
+{
+    clock_sync_board = board;
+    if (!board->hasRTC())
+    {
+        Serial.println("No RTC, the clock is set by SNTP");
+        return false;
+    }
+
+    // The RTC keeps UTC
+    RTC_DateTime datetime = board->getDateTime();
+    time_t rtc_time = utc_datetime_to_time(datetime.year, datetime.month, datetime.day, datetime.hour, datetime.minute, datetime.second);
+    if (!is_time_valid(rtc_time))
+    {
+        Serial.println("RTC time is not set yet");
+        return false;
+    }
+
+    struct timeval tv = {.tv_sec = rtc_time, .tv_usec = 0};
+    settimeofday(&tv, NULL);
+    Serial.printf("Clock seeded from RTC: %04u-%02u-%02u %02u:%02u:%02u UTC\n", datetime.year, datetime.month, datetime.day, datetime.hour, datetime.minute, datetime.second);
+    return true;
+}
+
+static void on_sntp_time_synced(struct timeval *tv)
+{
+    // Runs in the lwip task, the RTC is written later from clock_sync_update. The system clock
+    // may still be slewing towards the SNTP time, so the received time is kept instead
+    sntp_time = tv->tv_sec;
+    sntp_time_received_ms = millis();
+    rtc_write_pending = true;
+    if (clock_sync_on_synced != nullptr)
+    {
+        clock_sync_on_synced();
+    }
+}
+
+void clock_sync_start_sntp(const char *ntp_server, long gmt_offset_sec, int daylight_offset_sec, void (*on_synced)(void))
+{
+    clock_sync_on_synced = on_synced;
+    sntp_set_time_sync_notification_cb(on_sntp_time_synced);
+    // Small errors are slewed with adjtime so running timers do not jump, big ones are still stepped
+    sntp_set_sync_mode(SNTP_SYNC_MODE_SMOOTH);
+    configTime(gmt_offset_sec, daylight_offset_sec, ntp_server);
+}
+
+void clock_sync_update(void)
+{
+    if (!rtc_write_pending)
+    {
+        return;
+    }
+    rtc_write_pending = false;
+    if (clock_sync_board == nullptr || !clock_sync_board->hasRTC())
+    {
+        return;
+    }
+
+    time_t now = sntp_time + (millis() - sntp_time_received_ms) / 1000;
+    struct tm timeinfo;
+    gmtime_r(&now, &timeinfo);
+    clock_sync_board->setDateTime(timeinfo.tm_year + 1900, timeinfo.tm_mon + 1, timeinfo.tm_mday, timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec);
+    Serial.println("RTC updated from SNTP");
+}
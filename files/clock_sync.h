@@ -0,0 +1,10 @@
+#pragma once
+
+#include <LilyGo_AMOLED.h>
+
+// Seeds the system clock from the board RTC, so the clock is valid before the network is up
+bool clock_sync_begin(LilyGo_Class *board);
+// Starts SNTP in smooth mode, on_synced is called from the lwip task after every sync
+void clock_sync_start_sntp(const char *ntp_server, long gmt_offset_sec, int daylight_offset_sec, void (*on_synced)(void));
+// Writes a pending SNTP time to the RTC, call it regularly from a task that may use the I2C bus
+void clock_sync_update(void);
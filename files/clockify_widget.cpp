@@ -5,11 +5,16 @@
 #include <ArduinoJson.h>
 #include "clockify_widget.h"
 #include <utility>
+#include <map>
+#include <algorithm>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 #include "config.h"
 #include "utils.h"
 #include "fonts.h"
+#include "widget_state_store.h"
+#include "connectivity.h"
+#include "radio_power.h"
 
 struct time_interval
 {
@@ -27,6 +32,16 @@ struct time_entry
     bool has_time_interval = false;
 };
 
+// Rows a sync touched since the last render, so the list is patched instead of rebuilt
+struct time_entry_changes
+{
+    std::vector<std::string> inserted;
+    std::vector<std::string> updated;
+    std::vector<std::string> removed;
+
+    bool empty() const { return inserted.empty() && updated.empty() && removed.empty(); }
+};
+
 struct user_data
 {
     std::string user_id;
@@ -40,9 +55,12 @@ struct widget_data
     bool has_user_data = false;
     time_entry in_progress_entry = {};
     bool has_in_progress_entry = false;
-    std::vector<time_entry> time_entries;
+    std::vector<time_entry> time_entries; // newest first, a view of clockify_time_entry_store
+    time_entry_changes time_entries_changes;
     bool in_progress_entry_is_loading = false;
     bool entries_list_is_loading = false;
+    bool is_cached = false; // rendered from flash, not refreshed yet
+    time_t updated_at = 0;
 };
 
 lv_obj_t *clockify_widget_box;
@@ -56,6 +74,8 @@ lv_obj_t *no_timer_label;
 lv_obj_t *no_timer_list_label;
 lv_obj_t *in_progress_entry_spinner;
 lv_obj_t *entries_list_spinner;
+lv_obj_t *clockify_data_age_label;
+static std::map<std::string, lv_obj_t *> timer_list_rows; // entry id -> row in timer_list_box
 widget_data clockify_widget_data = {};
 widget_data clockify_widget_data_prev = {};
 bool init_render_clockify = true;
@@ -66,14 +86,23 @@ static bool stop_in_progress_entry_in_progress = false;
 static TaskHandle_t refresh_time_entries_task = NULL;
 static bool refresh_time_entries_in_progress = false;
 static TaskHandle_t clockify_widget_polling_task = NULL;
-static bool clockify_widget_polling_in_progress = false;
+static cancel_token clockify_widget_polling_cancel;
 static TaskHandle_t clockify_widget_timer_task = NULL;
-static bool clockify_widget_timer_in_progress = false;
+static cancel_token clockify_widget_timer_cancel;
+static volatile bool clockify_refresh_requested = false;
+static std::map<std::string, time_entry> clockify_time_entry_store; // the newest CLOCKIFY_TIME_ENTRIES_LIMIT entries by id
+static bool clockify_time_entries_synced = false;                   // a full sync has confirmed the store since boot
+static int clockify_delta_syncs = 0;                                 // since the last full sync
 
 const int REFRESH_CLOCKIFY_WIDGET_TIMER_FREQ_MS = 500;   // Refresh frequency in seconds
-const int REFRESH_CLOCKIFY_WIDGET_POLLING_FREQ_MS = 5000; // Refresh frequency in seconds
+const int REFRESH_CLOCKIFY_WIDGET_POLLING_FREQ_MS = 5000; // Refresh frequency in seconds, scaled by the radio power profile
+const char *CLOCKIFY_POLLING_RADIO_JOB = "ClockifyWidgetPolling";
+const size_t CLOCKIFY_TIME_ENTRIES_LIMIT = 5; // entries kept and listed
+const int CLOCKIFY_FULL_SYNC_EVERY = 10;      // delta syncs between full ones, only a full sync sees deleted entries
 
 const bool DEBUG_API_REQUESTS = true;
+const char *CLOCKIFY_WIDGET_STATE_KEY = "clockify";
+const uint8_t CLOCKIFY_WIDGET_STATE_VERSION = 1;
 
 std::string start_time_str_to_timer(std::string *start)
 {
@@ -93,15 +122,15 @@ std::string start_time_str_to_timer(std::string *start)
     return time_span_from_str(start, &current_time_str);
 }
 
-std::pair<bool, JsonDocument> send_http_request_clockify(const std::string serverEndpoint, const std::string http_method, const std::string payload="", const std::vector<std::pair<std::string, std::string>> headers={})
+std::pair<bool, JsonDocument> send_http_request_clockify(const std::string serverEndpoint, const std::string http_method, const std::string payload="", const cancel_token *cancel=nullptr)
 {
-    return send_http_request(serverEndpoint, http_method, payload, {{"x-api-key", CLOCKIFY_API_KEY}}, DEBUG_API_REQUESTS);
+    return send_http_request(serverEndpoint, http_method, payload, {{"x-api-key", CLOCKIFY_API_KEY}}, DEBUG_API_REQUESTS, cancel);
 }
 
-std::pair<bool, user_data> request_clockify_user_info(void)
+std::pair<bool, user_data> request_clockify_user_info(const cancel_token *cancel = nullptr)
 {
-    const std::string serverEndpoint = "https://api.clockify.me/api/v1/user";
-    auto [doc_valid, doc] = send_http_request_clockify(serverEndpoint, "GET");
+    const std::string serverEndpoint = CLOCKIFY_API_BASE_URL "/user";
+    auto [doc_valid, doc] = send_http_request_clockify(serverEndpoint, "GET", "", cancel);
 
     if (!doc_valid)
     {
@@ -116,7 +145,23 @@ std::pair<bool, user_data> request_clockify_user_info(void)
     return {true, user};
 }
 
-std::pair<bool, std::vector<time_entry>> request_clockify_time_entries()
+time_entry time_entry_from_json(JsonObject entry)
+{
+    return {
+        .id = (std::string)entry["id"].as<std::string>(),
+        .description = (std::string)entry["description"].as<std::string>(),
+        .projectId = entry["projectId"] ? (std::string)entry["projectId"].as<std::string>() : "",
+        .interval = {
+            .start = entry["timeInterval"]["start"] ? (std::string)entry["timeInterval"]["start"].as<std::string>() : "",
+            .end = entry["timeInterval"]["end"] ? (std::string)entry["timeInterval"]["end"].as<std::string>() : "",
+            .duration = entry["timeInterval"]["duration"] ? (std::string)entry["timeInterval"]["duration"].as<std::string>() : "",
+        },
+    };
+}
+
+// With since_start set only entries that started at or after it are returned, the newest known entry
+// included, so a refresh without changes costs a single entry
+std::pair<bool, std::vector<time_entry>> request_clockify_time_entries(const std::string &since_start = "")
 {
     if (clockify_widget_data.has_user_data == false)
     {
@@ -125,7 +170,11 @@ std::pair<bool, std::vector<time_entry>> request_clockify_time_entries()
     }
 
     user_data *user = &clockify_widget_data.user;
-    const std::string serverEndpoint = (String("https://api.clockify.me/api/v1/workspaces/") + user->workspace_id.c_str() + String("/user/") + user->user_id.c_str() + String("/time-entries?in-progress=false&page-size=5")).c_str();
+    std::string serverEndpoint = (String(CLOCKIFY_API_BASE_URL "/workspaces/") + user->workspace_id.c_str() + String("/user/") + user->user_id.c_str() + String("/time-entries?in-progress=false&page-size=") + String((int)CLOCKIFY_TIME_ENTRIES_LIMIT)).c_str();
+    if (!since_start.empty())
+    {
+        serverEndpoint += "&start=" + since_start;
+    }
     auto [doc_valid, doc] = send_http_request_clockify(serverEndpoint, "GET");
     if (!doc_valid)
     {
@@ -135,22 +184,13 @@ std::pair<bool, std::vector<time_entry>> request_clockify_time_entries()
     std::vector<time_entry> entries;
     for (JsonObject entry : doc.as<JsonArray>())
     {
-        time_entry te = {
-            .id = (std::string)entry["id"].as<std::string>(),
-            .description = (std::string)entry["description"].as<std::string>(),
-            .projectId = entry["projectId"] ? (std::string)entry["projectId"].as<std::string>() : "",
-            .interval = {
-                .start = entry["timeInterval"]["start"] ? (std::string)entry["timeInterval"]["start"].as<std::string>() : "",
-                .end = entry["timeInterval"]["end"] ? (std::string)entry["timeInterval"]["end"].as<std::string>() : "",
-                .duration = entry["timeInterval"]["duration"] ? (std::string)entry["timeInterval"]["duration"].as<std::string>() : "",
-            },
-        };
-        entries.push_back(te);
+        entries.push_back(time_entry_from_json(entry));
     }
     return {true, entries};
 }
 
-std::pair<bool, time_entry> request_clockify_in_progress_entry()
+// The entry id is empty when no entry is in progress, false only when the request failed
+std::pair<bool, time_entry> request_clockify_in_progress_entry(const cancel_token *cancel = nullptr)
 {
     if (clockify_widget_data.has_user_data == false)
     {
@@ -159,41 +199,193 @@ std::pair<bool, time_entry> request_clockify_in_progress_entry()
     }
 
     user_data *user = &clockify_widget_data.user;
-    const std::string serverEndpoint = (String("https://api.clockify.me/api/v1/workspaces/") + user->workspace_id.c_str() + String("/user/") + user->user_id.c_str() + String("/time-entries?in-progress=true&page-size=1")).c_str();
-    auto [doc_valid, doc] = send_http_request_clockify(serverEndpoint, "GET");
+    const std::string serverEndpoint = (String(CLOCKIFY_API_BASE_URL "/workspaces/") + user->workspace_id.c_str() + String("/user/") + user->user_id.c_str() + String("/time-entries?in-progress=true&page-size=1")).c_str();
+    auto [doc_valid, doc] = send_http_request_clockify(serverEndpoint, "GET", "", cancel);
     if (!doc_valid)
     {
         return {false, {}};
     }
 
+    JsonArray entries = doc.as<JsonArray>();
+    if (entries.size() > 0)
+    {
+        return {true, time_entry_from_json(entries[0])};
+    }
+    else
+    {
+        return {true, {}};
+    }
+}
+
+time_entry time_entry_from_gateway(JsonObject entry)
+{
+    return {
+        .id = (std::string)entry["id"].as<std::string>(),
+        .description = (std::string)entry["description"].as<std::string>(),
+        .projectId = (std::string)entry["project_id"].as<std::string>(),
+        .interval = {
+            .start = (std::string)entry["start"].as<std::string>(),
+            .end = (std::string)entry["end"].as<std::string>(),
+            .duration = (std::string)entry["duration"].as<std::string>(),
+        },
+    };
+}
+
+static bool time_entry_equals(const time_entry &a, const time_entry &b)
+{
+    return a.id == b.id && a.description == b.description && a.projectId == b.projectId && a.has_time_interval == b.has_time_interval &&
+           a.interval.start == b.interval.start && a.interval.end == b.interval.end && a.interval.duration == b.interval.duration;
+}
+
+static bool erase_id(std::vector<std::string> *ids, const std::string &id)
+{
+    auto it = std::find(ids->begin(), ids->end(), id);
+    if (it == ids->end())
+    {
+        return false;
+    }
+    ids->erase(it);
+    return true;
+}
+
+// Changes pile up until the next render, so fold them: a row inserted and removed in between was never shown
+static void note_time_entry_inserted(time_entry_changes *changes, const std::string &id)
+{
+    if (erase_id(&changes->removed, id))
+    {
+        changes->updated.push_back(id);
+        return;
+    }
+    changes->inserted.push_back(id);
+}
+
+static void note_time_entry_updated(time_entry_changes *changes, const std::string &id)
+{
+    bool noted = std::find(changes->inserted.begin(), changes->inserted.end(), id) != changes->inserted.end() ||
+                 std::find(changes->updated.begin(), changes->updated.end(), id) != changes->updated.end();
+    if (!noted)
+    {
+        changes->updated.push_back(id);
+    }
+}
+
+static void note_time_entry_removed(time_entry_changes *changes, const std::string &id)
+{
+    if (erase_id(&changes->inserted, id))
+    {
+        return;
+    }
+    erase_id(&changes->updated, id);
+    changes->removed.push_back(id);
+}
+
+// Merges fetched entries into the store by id and records what changed for the renderer. Only a full sync
+// can tell that an entry was deleted, a delta sync just lacks the older entries.
+// Must be called with the lvgl lock held, the list is rendered from the same data under it
+static void merge_time_entries(const std::vector<time_entry> &fetched, bool full_sync)
+{
+    time_entry_changes *changes = &clockify_widget_data.time_entries_changes;
+    if (full_sync)
+    {
+        for (auto it = clockify_time_entry_store.begin(); it != clockify_time_entry_store.end();)
+        {
+            bool fetched_again = std::any_of(fetched.begin(), fetched.end(), [&](const time_entry &entry)
+                                             { return entry.id == it->first; });
+            if (fetched_again)
+            {
+                ++it;
+                continue;
+            }
+            note_time_entry_removed(changes, it->first);
+            it = clockify_time_entry_store.erase(it);
+        }
+    }
+
+    for (const time_entry &entry : fetched)
+    {
+        auto it = clockify_time_entry_store.find(entry.id);
+        if (it == clockify_time_entry_store.end())
+        {
+            clockify_time_entry_store[entry.id] = entry;
+            note_time_entry_inserted(changes, entry.id);
+        }
+        else if (!time_entry_equals(it->second, entry))
+        {
+            it->second = entry;
+            note_time_entry_updated(changes, entry.id);
+        }
+    }
+
+    // Newest first, entries pushed past the limit fall off the end of the list
     std::vector<time_entry> entries;
-    for (JsonObject entry : doc.as<JsonArray>())
+    for (const auto &[id, entry] : clockify_time_entry_store)
+    {
+        entries.push_back(entry);
+    }
+    std::sort(entries.begin(), entries.end(), [](const time_entry &a, const time_entry &b)
+              { return a.interval.start > b.interval.start; });
+    while (entries.size() > CLOCKIFY_TIME_ENTRIES_LIMIT)
     {
-        time_entry te = {
-            .id = (std::string)entry["id"].as<std::string>(),
-            .description = (std::string)entry["description"].as<std::string>(),
-            .projectId = entry["projectId"] ? (std::string)entry["projectId"].as<std::string>() : "",
-            .interval = {
-                .start = entry["timeInterval"]["start"] ? (std::string)entry["timeInterval"]["start"].as<std::string>() : "",
-                .end = entry["timeInterval"]["end"] ? (std::string)entry["timeInterval"]["end"].as<std::string>() : "",
-                .duration = entry["timeInterval"]["duration"] ? (std::string)entry["timeInterval"]["duration"].as<std::string>() : "",
-            },
-        };
-        entries.push_back(te);
+        note_time_entry_removed(changes, entries.back().id);
+        clockify_time_entry_store.erase(entries.back().id);
+        entries.pop_back();
     }
+    clockify_widget_data.time_entries = entries;
+}
 
-    if (entries.size() > 0)
+// One document from tools/gateway carries the user, the in progress entry and the recent entries
+bool set_clockify_widget_data_from_gateway(const cancel_token *cancel = nullptr)
+{
+    auto [doc_valid, doc] = send_http_request(GATEWAY_URL "/v1/clockify", "GET", "", {{"Accept", "application/msgpack"}}, DEBUG_API_REQUESTS, cancel);
+    if (!doc_valid)
     {
-        return {true, entries[0]};
+        if (cancel == nullptr || !cancel->is_cancelled())
+        {
+            Serial.println("Gateway unavailable, requesting clockify data directly");
+        }
+        return false;
     }
-    else
+
+    clockify_widget_data.user = {
+        .user_id = (std::string)doc["user"]["id"].as<std::string>(),
+        .workspace_id = (std::string)doc["user"]["workspace_id"].as<std::string>(),
+        .time_zone = (std::string)doc["user"]["time_zone"].as<std::string>(),
+    };
+    clockify_widget_data.has_user_data = true;
+
+    std::vector<time_entry> entries;
+    for (JsonObject entry : doc["entries"].as<JsonArray>())
     {
-        return {false, {}};
+        entries.push_back(time_entry_from_gateway(entry));
     }
+    // The gateway always sends the recent entries in full, they still only touch the rows that changed
+    lv_lock();
+    merge_time_entries(entries, true);
+    lv_unlock();
+
+    JsonObject in_progress_entry = doc["in_progress"].as<JsonObject>();
+    clockify_widget_data.has_in_progress_entry = !in_progress_entry.isNull();
+    clockify_widget_data.in_progress_entry = in_progress_entry.isNull() ? time_entry{} : time_entry_from_gateway(in_progress_entry);
+    clockify_widget_data.is_cached = false;
+    clockify_widget_data.updated_at = get_current_utc_time();
+    return true;
 }
 
 bool request_clockify_stop_in_progress_entry()
 {
+    if (gateway_enabled())
+    {
+        // The gateway stamps the end time and refreshes its document before answering
+        bool request_sent;
+        auto [doc_valid, doc] = send_http_request(GATEWAY_URL "/v1/clockify/stop", "POST", "{}", {{"Accept", "application/msgpack"}}, DEBUG_API_REQUESTS, nullptr, &request_sent);
+        // Once the gateway got the request it may have stopped the entry upstream, only an unreachable one falls back
+        if (doc_valid || request_sent)
+        {
+            return doc_valid;
+        }
+        Serial.println("Gateway unavailable, stopping the clockify entry directly");
+    }
+
     if (clockify_widget_data.has_user_data == false)
     {
         Serial.println("No user data, cannot request stop in progress entry");
@@ -201,18 +393,20 @@ bool request_clockify_stop_in_progress_entry()
     }
 
     user_data *user = &clockify_widget_data.user;
-    struct tm timeinfo;
-    if (!getLocalTime(&timeinfo, 5000))
+    time_t now = get_current_utc_time();
+    if (!is_time_valid(now))
     {
-        Serial.println("Failed to obtain time");
-        throw std::invalid_argument("Failed to obtain time");
+        Serial.println("Clock not set, cannot stop in progress entry");
+        return false;
     }
 
+    struct tm timeinfo;
+    gmtime_r(&now, &timeinfo);
     char end_time_str[30];
     strftime(end_time_str, sizeof(end_time_str), "%Y-%m-%dT%H:%M:%SZ", &timeinfo);
     String patch_payload = "{\"end\": \"" + String(end_time_str) + "\"}";
 
-    const std::string serverEndpoint = (String("https://api.clockify.me/api/v1/workspaces/") + user->workspace_id.c_str() + String("/user/") + user->user_id.c_str() + String("/time-entries")).c_str();
+    const std::string serverEndpoint = (String(CLOCKIFY_API_BASE_URL "/workspaces/") + user->workspace_id.c_str() + String("/user/") + user->user_id.c_str() + String("/time-entries")).c_str();
     auto [doc_valid, doc] = send_http_request_clockify(serverEndpoint, "PATCH", patch_payload.c_str());
     if (!doc_valid)
     {
@@ -223,6 +417,22 @@ bool request_clockify_stop_in_progress_entry()
 
 bool request_clockify_create_entry_from_another(time_entry *from_entry)
 {
+    if (gateway_enabled())
+    {
+        JsonDocument request;
+        request["description"] = from_entry->description;
+        request["projectId"] = from_entry->projectId;
+        std::string payload;
+        serializeJson(request, payload);
+        bool request_sent;
+        auto [doc_valid, doc] = send_http_request(GATEWAY_URL "/v1/clockify/start", "POST", payload, {{"Accept", "application/msgpack"}}, DEBUG_API_REQUESTS, nullptr, &request_sent);
+        if (doc_valid || request_sent)
+        {
+            return doc_valid;
+        }
+        Serial.println("Gateway unavailable, creating the clockify entry directly");
+    }
+
     if (clockify_widget_data.has_user_data == false)
     {
         Serial.println("No user data, cannot request create entry from another");
@@ -230,26 +440,28 @@ bool request_clockify_create_entry_from_another(time_entry *from_entry)
     }
 
     user_data *user = &clockify_widget_data.user;
-    struct tm timeinfo;
-    if (!getLocalTime(&timeinfo, 5000))
+    time_t now = get_current_utc_time();
+    if (!is_time_valid(now))
     {
-        Serial.println("Failed to obtain time");
-        throw std::invalid_argument("Failed to obtain time");
+        Serial.println("Clock not set, cannot create entry");
+        return false;
     }
 
+    struct tm timeinfo;
+    gmtime_r(&now, &timeinfo);
     char start_time_str[30];
     strftime(start_time_str, sizeof(start_time_str), "%Y-%m-%dT%H:%M:%SZ", &timeinfo);
     String patch_payload = "{";
     patch_payload += "\"description\": \"" + String(from_entry->description.c_str()) + "\",";
     patch_payload += "\"start\": \"" + String(start_time_str) + "\",";
-    if (from_entry->projectId.c_str() != "")
+    if (!from_entry->projectId.empty())
     {
         patch_payload += "\"projectId\": \"" + String(from_entry->projectId.c_str()) + "\",";
     }
     patch_payload += "\"type\": \"REGULAR\"";
     patch_payload += "}";
 
-    const std::string serverEndpoint = (String("https://api.clockify.me/api/v1/workspaces/") + user->workspace_id.c_str() + String("/user/") + user->user_id.c_str() + String("/time-entries")).c_str();
+    const std::string serverEndpoint = (String(CLOCKIFY_API_BASE_URL "/workspaces/") + user->workspace_id.c_str() + String("/user/") + user->user_id.c_str() + String("/time-entries")).c_str();
     auto [doc_valid, doc] = send_http_request_clockify(serverEndpoint, "POST", patch_payload.c_str());
     if (!doc_valid)
     {
@@ -258,9 +470,9 @@ bool request_clockify_create_entry_from_another(time_entry *from_entry)
     return true;
 }
 
-bool set_clockify_widget_data_user_data()
+bool set_clockify_widget_data_user_data(const cancel_token *cancel = nullptr)
 {
-    auto [user_info_flag, user] = request_clockify_user_info();
+    auto [user_info_flag, user] = request_clockify_user_info(cancel);
     if (user_info_flag)
     {
         clockify_widget_data.user.time_zone = user.time_zone;
@@ -278,44 +490,153 @@ bool set_clockify_widget_data_user_data()
 
 bool set_clockify_widget_data_time_entries()
 {
+    if (gateway_enabled() && set_clockify_widget_data_from_gateway())
+    {
+        return true;
+    }
+
     if (clockify_widget_data.has_user_data == false)
     {
         set_clockify_widget_data_user_data();
     }
 
-    auto [time_entries_flag, time_entries] = request_clockify_time_entries();
+    // Entries from flash are not trusted until a full sync, after that only newer entries are asked for
+    bool full_sync = !clockify_time_entries_synced || clockify_widget_data.time_entries.empty() || clockify_delta_syncs >= CLOCKIFY_FULL_SYNC_EVERY;
+    std::string since_start = full_sync ? "" : clockify_widget_data.time_entries[0].interval.start;
+    auto [time_entries_flag, time_entries] = request_clockify_time_entries(since_start);
     if (time_entries_flag)
     {
-        clockify_widget_data.time_entries = time_entries;
+        lv_lock();
+        merge_time_entries(time_entries, full_sync);
+        const time_entry_changes &changes = clockify_widget_data.time_entries_changes;
+        if (DEBUG_API_REQUESTS)
+        {
+            Serial.printf("Clockify %s sync: %u entries received, %u inserted, %u updated, %u removed pending render\n", full_sync ? "full" : "delta",
+                          time_entries.size(), changes.inserted.size(), changes.updated.size(), changes.removed.size());
+        }
+        lv_unlock();
+        clockify_time_entries_synced = clockify_time_entries_synced || full_sync;
+        clockify_delta_syncs = full_sync ? 0 : clockify_delta_syncs + 1;
+        clockify_widget_data.is_cached = false;
+        clockify_widget_data.updated_at = get_current_utc_time();
         return true;
     }
     else
     {
-        clockify_widget_data.time_entries = {};
+        // Keep showing the last known entries instead of an empty list
         return false;
     }
 }
 
-bool set_clockify_widget_data_in_progress_entry()
+bool set_clockify_widget_data_in_progress_entry(const cancel_token *cancel = nullptr)
 {
+    if (gateway_enabled() && set_clockify_widget_data_from_gateway(cancel))
+    {
+        return clockify_widget_data.has_in_progress_entry;
+    }
+
     if (clockify_widget_data.has_user_data == false)
     {
-        set_clockify_widget_data_user_data();
+        set_clockify_widget_data_user_data(cancel);
     }
 
-    auto [in_progress_entry_flag, in_progress_entry] = request_clockify_in_progress_entry();
-    if (in_progress_entry_flag)
+    auto [in_progress_entry_flag, in_progress_entry] = request_clockify_in_progress_entry(cancel);
+    if (!in_progress_entry_flag)
     {
-        clockify_widget_data.in_progress_entry = in_progress_entry;
-        clockify_widget_data.has_in_progress_entry = true;
-        return true;
+        // A failed or cancelled request says nothing about the entry, keep the last known one
+        return clockify_widget_data.has_in_progress_entry;
     }
-    else
+
+    clockify_widget_data.has_in_progress_entry = !in_progress_entry.id.empty();
+    clockify_widget_data.in_progress_entry = in_progress_entry;
+    return clockify_widget_data.has_in_progress_entry;
+}
+
+void write_time_entry_state(state_writer *writer, const time_entry *entry)
+{
+    writer->write_string(entry->id);
+    writer->write_string(entry->description);
+    writer->write_string(entry->projectId);
+    writer->write_string(entry->interval.start);
+    writer->write_string(entry->interval.end);
+    writer->write_string(entry->interval.duration);
+    writer->write_u8(entry->has_time_interval);
+}
+
+time_entry read_time_entry_state(state_reader *reader)
+{
+    time_entry entry;
+    entry.id = reader->read_string();
+    entry.description = reader->read_string();
+    entry.projectId = reader->read_string();
+    entry.interval.start = reader->read_string();
+    entry.interval.end = reader->read_string();
+    entry.interval.duration = reader->read_string();
+    entry.has_time_interval = reader->read_u8();
+    return entry;
+}
+
+void save_clockify_widget_state()
+{
+    state_writer writer;
+    writer.write_u8(clockify_widget_data.has_user_data);
+    writer.write_string(clockify_widget_data.user.user_id);
+    writer.write_string(clockify_widget_data.user.workspace_id);
+    writer.write_string(clockify_widget_data.user.time_zone);
+    writer.write_u8(clockify_widget_data.has_in_progress_entry);
+    if (clockify_widget_data.has_in_progress_entry)
+    {
+        write_time_entry_state(&writer, &clockify_widget_data.in_progress_entry);
+    }
+    writer.write_u8(clockify_widget_data.time_entries.size());
+    for (const time_entry &entry : clockify_widget_data.time_entries)
+    {
+        write_time_entry_state(&writer, &entry);
+    }
+    save_widget_state(CLOCKIFY_WIDGET_STATE_KEY, CLOCKIFY_WIDGET_STATE_VERSION, writer);
+}
+
+bool load_clockify_widget_state()
+{
+    auto [is_state_valid, state] = load_widget_state(CLOCKIFY_WIDGET_STATE_KEY, CLOCKIFY_WIDGET_STATE_VERSION);
+    if (!is_state_valid)
     {
-        clockify_widget_data.has_in_progress_entry = false;
-        clockify_widget_data.in_progress_entry = {};
         return false;
     }
+
+    widget_data data = {};
+    state_reader reader = {.data = state.payload.data(), .size = state.payload.size()};
+    data.has_user_data = reader.read_u8();
+    data.user.user_id = reader.read_string();
+    data.user.workspace_id = reader.read_string();
+    data.user.time_zone = reader.read_string();
+    data.has_in_progress_entry = reader.read_u8();
+    if (data.has_in_progress_entry)
+    {
+        data.in_progress_entry = read_time_entry_state(&reader);
+    }
+    data.time_entries.resize(reader.read_u8());
+    for (time_entry &entry : data.time_entries)
+    {
+        entry = read_time_entry_state(&reader);
+    }
+
+    if (!reader.ok)
+    {
+        Serial.println("Clockify widget state is corrupted, ignoring it");
+        return false;
+    }
+    data.is_cached = true;
+    data.updated_at = state.saved_at;
+    clockify_widget_data = data;
+
+    clockify_time_entry_store.clear();
+    for (const time_entry &entry : clockify_widget_data.time_entries)
+    {
+        clockify_time_entry_store[entry.id] = entry;
+        clockify_widget_data.time_entries_changes.inserted.push_back(entry.id);
+    }
+    return true;
 }
 
 static void on_stop_timer_btn_click(lv_event_t *e); // Predeclaration
@@ -335,10 +656,31 @@ void render_clockify_widget_box(lv_obj_t *parent)
         lv_obj_set_layout(clockify_widget_box, LV_LAYOUT_FLEX);
         lv_obj_set_flex_flow(clockify_widget_box, LV_FLEX_FLOW_COLUMN);     // Display Flex column
         lv_obj_set_style_pad_all(clockify_widget_box, 5, LV_PART_MAIN);    // Padding
+
+        clockify_data_age_label = lv_label_create(clockify_widget_box);
+        lv_obj_set_style_text_font(clockify_data_age_label, &lv_font_montserrat_14, 0);
+        lv_obj_set_style_text_color(clockify_data_age_label, lv_color_hex(0x5a6b7b), LV_PART_MAIN);
+        lv_obj_add_flag(clockify_data_age_label, LV_OBJ_FLAG_HIDDEN);
         lv_unlock();
     }
 }
 
+void render_clockify_data_age()
+{
+    lv_lock();
+    if (clockify_widget_data.is_cached)
+    {
+        lv_label_set_text_fmt(clockify_data_age_label, "%s %s", LV_SYMBOL_REFRESH, format_data_age(clockify_widget_data.updated_at).c_str());
+        lv_obj_remove_flag(clockify_data_age_label, LV_OBJ_FLAG_HIDDEN);
+        lv_obj_move_to_index(clockify_data_age_label, -1); // Keep it below the list
+    }
+    else
+    {
+        lv_obj_add_flag(clockify_data_age_label, LV_OBJ_FLAG_HIDDEN);
+    }
+    lv_unlock();
+}
+
 void render_in_progress_box_entry()
 {
     lv_lock();
@@ -425,6 +767,62 @@ void render_in_progress_box_entry()
     lv_unlock();
 }
 
+static void on_timer_list_row_delete(lv_event_t *e)
+{
+    delete (std::string *)lv_event_get_user_data(e);
+}
+
+static void set_timer_list_row_labels(lv_obj_t *row, const time_entry &entry)
+{
+    lv_obj_t *list_item_left_box = lv_obj_get_child(row, 0);
+    lv_label_set_text(lv_obj_get_child(list_item_left_box, 0), entry.description.c_str());
+    std::string start = entry.interval.start;
+    std::string end = entry.interval.end;
+    lv_label_set_text(lv_obj_get_child(list_item_left_box, 1), time_span_from_str(&start, &end).c_str());
+}
+
+static lv_obj_t *create_timer_list_row(const time_entry &entry)
+{
+    lv_obj_t *timer_list_item_box = create_lv_div(timer_list_box);
+    lv_obj_set_size(timer_list_item_box, lv_pct(100), 80);
+    lv_obj_set_style_bg_color(timer_list_item_box, lv_color_hex(0xffffff), LV_PART_MAIN);
+    lv_obj_set_flex_flow(timer_list_item_box, LV_FLEX_FLOW_ROW);
+    lv_obj_set_style_flex_main_place(timer_list_item_box, LV_FLEX_ALIGN_SPACE_BETWEEN, LV_PART_MAIN);
+    lv_obj_set_style_flex_cross_place(timer_list_item_box, LV_FLEX_ALIGN_CENTER, LV_PART_MAIN);
+    lv_obj_set_style_pad_left(timer_list_item_box, 10, LV_PART_MAIN);
+
+    lv_obj_t *list_item_left_box = create_lv_div(timer_list_item_box);
+    lv_obj_set_flex_grow(list_item_left_box, 1);
+    lv_obj_set_flex_flow(list_item_left_box, LV_FLEX_FLOW_COLUMN);
+
+    lv_obj_t *list_item_name_label = lv_label_create(list_item_left_box);
+    lv_label_set_long_mode(list_item_name_label, LV_LABEL_LONG_MODE_DOTS); /*Break the long lines*/
+    lv_obj_set_style_text_font(list_item_name_label, &arial_20, 0);
+    lv_obj_set_style_text_color(list_item_name_label, lv_color_hex(0x0a0e10), LV_PART_MAIN);
+
+    lv_obj_t *list_item_time_span_label = lv_label_create(list_item_left_box);
+    lv_obj_set_style_text_font(list_item_time_span_label, &arial_20, 0);
+    lv_obj_set_style_text_color(list_item_time_span_label, lv_color_hex(0x0a0e10), LV_PART_MAIN);
+
+    // The button refers to the entry by id, the entry itself may be replaced by a later sync
+    std::string *entry_id = new std::string(entry.id);
+    lv_obj_add_event_cb(timer_list_item_box, on_timer_list_row_delete, LV_EVENT_DELETE, entry_id);
+
+    lv_obj_t *list_item_btn = lv_btn_create(timer_list_item_box);
+    lv_obj_add_event_cb(list_item_btn, on_play_timer_btn_click, LV_EVENT_PRESSED, entry_id);
+    lv_obj_set_style_bg_color(list_item_btn, lv_color_hex(0x03a9f4), LV_PART_MAIN);
+    lv_obj_set_size(list_item_btn, 80, 80);
+
+    lv_obj_t *list_item_btn_label = lv_label_create(list_item_btn);
+    lv_obj_add_flag(list_item_btn_label, LV_OBJ_FLAG_EVENT_BUBBLE); // Bubble event
+    lv_obj_center(list_item_btn_label);
+    lv_label_set_text(list_item_btn_label, LV_SYMBOL_PLAY);
+    lv_obj_set_style_text_font(list_item_btn_label, &lv_font_montserrat_26, 0);
+
+    set_timer_list_row_labels(timer_list_item_box, entry);
+    return timer_list_item_box;
+}
+
 void render_timer_entries_list_box()
 {
     lv_lock();
@@ -440,10 +838,11 @@ void render_timer_entries_list_box()
         lv_obj_set_flag(timer_list_box, LV_OBJ_FLAG_SCROLLABLE, true);
     }
  
-    if (clockify_widget_data.entries_list_is_loading && timer_list_box != nullptr)
+    if (clockify_widget_data.entries_list_is_loading && timer_list_box != nullptr && entries_list_spinner == nullptr)
     {
         Serial.println("Rendering entries list spinner");
         lv_obj_clean(timer_list_box); // Delete all children from the box
+        timer_list_rows.clear();
         no_timer_list_label = nullptr;
         lv_obj_set_flex_align(timer_list_box, LV_FLEX_ALIGN_CENTER, LV_FLEX_ALIGN_CENTER, LV_FLEX_ALIGN_CENTER);
 
@@ -452,59 +851,52 @@ void render_timer_entries_list_box()
         lv_spinner_set_anim_params(entries_list_spinner, 1500, 200);
     }
 
-    if (clockify_widget_data.entries_list_is_loading == false && clockify_widget_data.time_entries.size() > 0 && timer_list_box != nullptr && is_clockify_widget_data_changed_time_entries())
+    time_entry_changes &changes = clockify_widget_data.time_entries_changes;
+    bool rows_missing = timer_list_rows.size() != clockify_widget_data.time_entries.size();
+    if (clockify_widget_data.entries_list_is_loading == false && clockify_widget_data.time_entries.size() > 0 && timer_list_box != nullptr && (!changes.empty() || rows_missing))
     {
-        Serial.println("Rendering timer entries list box");
-        lv_obj_clean(timer_list_box); // Delete all children from the box
-        lv_obj_set_flex_align(timer_list_box, LV_FLEX_ALIGN_START, LV_FLEX_ALIGN_CENTER, LV_FLEX_ALIGN_CENTER);
-        no_timer_list_label = nullptr;
-        entries_list_spinner = nullptr;
+        Serial.printf("Patching timer entries list: %u inserted, %u updated, %u removed\n", changes.inserted.size(), changes.updated.size(), changes.removed.size());
+        if (entries_list_spinner != nullptr || no_timer_list_label != nullptr)
+        {
+            lv_obj_clean(timer_list_box); // Placeholder only, no rows yet
+            lv_obj_set_flex_align(timer_list_box, LV_FLEX_ALIGN_START, LV_FLEX_ALIGN_CENTER, LV_FLEX_ALIGN_CENTER);
+            no_timer_list_label = nullptr;
+            entries_list_spinner = nullptr;
+        }
 
-        uint32_t i;
-        int size = clockify_widget_data.time_entries.size() > 10?10:clockify_widget_data.time_entries.size();
-        for (i = 0; i < size; i++)
+        for (const std::string &id : changes.removed)
         {
-            time_entry *entry = &clockify_widget_data.time_entries[i];
-
-            lv_obj_t *timer_list_item_box = create_lv_div(timer_list_box);
-            lv_obj_set_size(timer_list_item_box, lv_pct(100), 80);
-            lv_obj_set_style_bg_color(timer_list_item_box, lv_color_hex(0xffffff), LV_PART_MAIN);
-            lv_obj_set_flex_flow(timer_list_item_box, LV_FLEX_FLOW_ROW);
-            lv_obj_set_style_flex_main_place(timer_list_item_box, LV_FLEX_ALIGN_SPACE_BETWEEN, LV_PART_MAIN);
-            lv_obj_set_style_flex_cross_place(timer_list_item_box, LV_FLEX_ALIGN_CENTER, LV_PART_MAIN);
-            lv_obj_set_style_pad_left(timer_list_item_box, 10, LV_PART_MAIN);
-
-            lv_obj_t *list_item_left_box = create_lv_div(timer_list_item_box);
-            lv_obj_set_flex_grow(list_item_left_box, 1);
-            lv_obj_set_flex_flow(list_item_left_box, LV_FLEX_FLOW_COLUMN);
-
-            lv_obj_t *list_item_name_label = lv_label_create(list_item_left_box);
-            lv_label_set_text(list_item_name_label, entry->description.c_str());
-            lv_label_set_long_mode(list_item_name_label, LV_LABEL_LONG_MODE_DOTS); /*Break the long lines*/
-            lv_obj_set_style_text_font(list_item_name_label, &arial_20, 0);
-            lv_obj_set_style_text_color(list_item_name_label, lv_color_hex(0x0a0e10), LV_PART_MAIN);
-  
-            lv_obj_t *list_item_time_span_label = lv_label_create(list_item_left_box);
-            lv_label_set_text(list_item_time_span_label, time_span_from_str(&entry->interval.start, &entry->interval.end).c_str());
-            lv_obj_set_style_text_font(list_item_time_span_label, &arial_20, 0);
-            lv_obj_set_style_text_color(list_item_time_span_label, lv_color_hex(0x0a0e10), LV_PART_MAIN);
-
-            lv_obj_t *list_item_btn = lv_btn_create(timer_list_item_box);
-            lv_obj_add_event_cb(list_item_btn, on_play_timer_btn_click, LV_EVENT_PRESSED, &clockify_widget_data.time_entries[i]);
-            lv_obj_set_style_bg_color(list_item_btn, lv_color_hex(0x03a9f4), LV_PART_MAIN);
-            lv_obj_set_size(list_item_btn, 80, 80);
-
-            lv_obj_t *list_item_btn_label = lv_label_create(list_item_btn);
-            lv_obj_add_flag(list_item_btn_label, LV_OBJ_FLAG_EVENT_BUBBLE); // Bubble event
-            lv_obj_center(list_item_btn_label);
-            lv_label_set_text(list_item_btn_label, LV_SYMBOL_PLAY);
-            lv_obj_set_style_text_font(list_item_btn_label, &lv_font_montserrat_26, 0);
+            auto row = timer_list_rows.find(id);
+            if (row != timer_list_rows.end())
+            {
+                lv_obj_delete(row->second);
+                timer_list_rows.erase(row);
+            }
         }
+
+        // Rows are created for new entries and relabelled for updated ones, then put in start order
+        for (size_t i = 0; i < clockify_widget_data.time_entries.size(); i++)
+        {
+            const time_entry &entry = clockify_widget_data.time_entries[i];
+            auto row = timer_list_rows.find(entry.id);
+            if (row == timer_list_rows.end())
+            {
+                row = timer_list_rows.emplace(entry.id, create_timer_list_row(entry)).first;
+            }
+            else if (std::find(changes.updated.begin(), changes.updated.end(), entry.id) != changes.updated.end())
+            {
+                set_timer_list_row_labels(row->second, entry);
+            }
+            lv_obj_move_to_index(row->second, i);
+        }
+        changes = {};
     }
     
     if (clockify_widget_data.entries_list_is_loading == false &&clockify_widget_data.time_entries.size() == 0 && timer_list_box != nullptr && no_timer_list_label == nullptr)
     {
         lv_obj_clean(timer_list_box); // Delete all children from the box
+        timer_list_rows.clear();
+        changes = {};
         entries_list_spinner = nullptr;
         lv_obj_set_flex_align(timer_list_box, LV_FLEX_ALIGN_CENTER, LV_FLEX_ALIGN_CENTER, LV_FLEX_ALIGN_CENTER);
 
@@ -518,7 +910,7 @@ void render_timer_entries_list_box()
 
 bool clockify_widget_polling_update(void)
 {
-    return set_clockify_widget_data_in_progress_entry();
+    return set_clockify_widget_data_in_progress_entry(&clockify_widget_polling_cancel);
 }
 
 bool clockify_widget_timer_update(void)
@@ -535,25 +927,44 @@ bool clockify_widget_timer_update(void)
 
 void clockify_widget_timer_task_func(void *parameter)
 {
-    while (true)
+    do
     {
         clockify_widget_timer_update();
-        vTaskDelay(pdMS_TO_TICKS(REFRESH_CLOCKIFY_WIDGET_TIMER_FREQ_MS));
-    }
+    } while (clockify_widget_timer_cancel.sleep_ms(REFRESH_CLOCKIFY_WIDGET_TIMER_FREQ_MS));
+
+    clockify_widget_timer_task = NULL;
+    vTaskDelete(NULL);
 }
 
+// Stopped through clockify_widget_polling_cancel, which also abandons a request in flight, so the task
+// always returns through here with its sockets closed
 void clockify_widget_polling_task_func(void *parameter)
 {
-    while (true)
+    uint32_t polling_freq_ms;
+    do
     {
-        clockify_widget_polling_update();
-        vTaskDelay(pdMS_TO_TICKS(REFRESH_CLOCKIFY_WIDGET_POLLING_FREQ_MS));
+        if (connectivity_is_online())
+        {
+            clockify_widget_polling_update();
+        }
+        polling_freq_ms = radio_power_poll_interval_ms(REFRESH_CLOCKIFY_WIDGET_POLLING_FREQ_MS);
+        radio_power_schedule_wake(CLOCKIFY_POLLING_RADIO_JOB, millis() + polling_freq_ms);
+    } while (clockify_widget_polling_cancel.sleep_ms(polling_freq_ms));
+
+    radio_power_cancel_wake(CLOCKIFY_POLLING_RADIO_JOB);
+    if (DEBUG_API_REQUESTS)
+    {
+        Serial.printf("Clockify polling stopped, free heap %u\n", ESP.getFreeHeap());
     }
+    clockify_widget_polling_task = NULL;
+    vTaskDelete(NULL);
 }
 
 static void refresh_time_entries_task_func(void *parameter)
 {
-    clockify_widget_data.entries_list_is_loading = true;
+    connectivity_wait_online(UINT32_MAX);
+    // Cached entries stay on screen while refreshing, the spinner is only for an empty list
+    clockify_widget_data.entries_list_is_loading = clockify_widget_data.time_entries.empty();
     set_clockify_widget_data_time_entries();
     clockify_widget_data.entries_list_is_loading = false;
 
@@ -564,9 +975,10 @@ static void refresh_time_entries_task_func(void *parameter)
 
 static void create_entry_from_another_task_func(void *parameter)
 {
-    time_entry *entry = (time_entry *)parameter;
+    time_entry *entry = (time_entry *)parameter; // a copy, owned by the task
     Serial.printf("Play entry id %s name %s\n", entry->id.c_str(), entry->description.c_str());
     request_clockify_create_entry_from_another(entry);
+    delete entry;
     // task will pick up the new in progress entry
 
     bool success = set_clockify_widget_data_in_progress_entry();
@@ -594,29 +1006,27 @@ static void stop_in_progress_entry_task_func(void *parameter)
     vTaskDelete(NULL);
 }
 
+// A task that is still winding down after a stop is left to exit, it is restarted on a later call
 void start_clockify_widget_tasks(void)
 {
-    if (!clockify_widget_polling_in_progress) {
-        clockify_widget_polling_in_progress = true;
+    if (clockify_widget_polling_task == NULL) {
+        clockify_widget_polling_cancel.reset();
         xTaskCreate(clockify_widget_polling_task_func, "ClockifyWidgetPolling", 8192, NULL, 1, &clockify_widget_polling_task);
     }
-    if (!clockify_widget_timer_in_progress) {
-        clockify_widget_timer_in_progress = true;
+    if (clockify_widget_timer_task == NULL) {
+        clockify_widget_timer_cancel.reset();
         xTaskCreate(clockify_widget_timer_task_func, "ClockifyWidgetTimer", 8192, NULL, 1, &clockify_widget_timer_task);
     }
 }
 
+// The tasks are never deleted from here: one may be holding the lvgl lock or an open connection
 void stop_clockify_widget_tasks(void)
 {
-    if (clockify_widget_polling_in_progress) {
-        clockify_widget_polling_in_progress = false;
-        vTaskDelete(clockify_widget_polling_task);
-        clockify_widget_polling_task = NULL;
+    if (clockify_widget_polling_task != NULL) {
+        clockify_widget_polling_cancel.cancel();
     }
-    if (clockify_widget_timer_in_progress) {
-        clockify_widget_timer_in_progress = false;
-        vTaskDelete(clockify_widget_timer_task);
-        clockify_widget_timer_task = NULL;
+    if (clockify_widget_timer_task != NULL) {
+        clockify_widget_timer_cancel.cancel();
     }
 }
 
@@ -636,49 +1046,22 @@ static void on_play_timer_btn_click(lv_event_t *e)
         Serial.println("In progress entry, cannot create entry from another");
         return;
     }
-    time_entry *entry = (time_entry *)lv_event_get_user_data(e);
+    const std::string *entry_id = (const std::string *)lv_event_get_user_data(e);
+    auto entry = clockify_time_entry_store.find(*entry_id);
+    if (entry == clockify_time_entry_store.end())
+    {
+        return; // removed by a sync, the row goes with the next render
+    }
     if (!create_entry_from_another_in_progress) {
         create_entry_from_another_in_progress = true;
         clockify_widget_data.in_progress_entry_is_loading = true;
-        xTaskCreate(create_entry_from_another_task_func, "CreateEntryFromAnother", 8192, entry, 1, &create_entry_from_another_task);
+        xTaskCreate(create_entry_from_another_task_func, "CreateEntryFromAnother", 8192, new time_entry(entry->second), 1, &create_entry_from_another_task);
     }
 }
 
 bool is_clockify_widget_data_changed_time_entries()
 {
-    auto *current = &clockify_widget_data;
-    auto *prev = &clockify_widget_data_prev;
-
-     // Compare time entries vector
-     if (current->time_entries.size() != prev->time_entries.size())
-     {
-         return true;
-     }
- 
-     for (size_t i = 0; i < current->time_entries.size(); i++)
-     {
-         const time_entry &current_entry = current->time_entries[i];
-         const time_entry &prev_entry = prev->time_entries[i];
- 
-         if (current_entry.id != prev_entry.id ||
-             current_entry.description != prev_entry.description ||
-             current_entry.projectId != prev_entry.projectId ||
-             current_entry.has_time_interval != prev_entry.has_time_interval)
-         {
-             return true;
-         }
- 
-         if (current_entry.has_time_interval)
-         {
-             if (current_entry.interval.start != prev_entry.interval.start ||
-                 current_entry.interval.end != prev_entry.interval.end ||
-                 current_entry.interval.duration != prev_entry.interval.duration)
-             {
-                 return true;
-             }
-         }
-     }
-     return false;
+    return !clockify_widget_data.time_entries_changes.empty();
 }
 
 bool is_clockify_widget_data_changed_in_progress_entry()
@@ -730,6 +1113,11 @@ bool is_clockify_widget_data_changed()
         return true;
     }
 
+    if (current->is_cached != prev->is_cached)
+    {
+        return true;
+    }
+
     // Compare user data
     if (current->has_user_data != prev->has_user_data ||
         current->user.user_id != prev->user.user_id ||
@@ -752,6 +1140,15 @@ bool is_clockify_widget_data_changed()
     return false;
 }
 
+static void on_clockify_widget_connectivity_changed(connectivity_state state)
+{
+    // Cached data left over from a failed refresh is refreshed once the network is back
+    if (state == CONNECTIVITY_ONLINE && connectivity_is_clock_valid() && clockify_widget_data.is_cached)
+    {
+        clockify_refresh_requested = true;
+    }
+}
+
 extern "C" void render_clockify_widget(lv_obj_t *parent)
 {
     if (init_render_clockify)
@@ -763,14 +1160,28 @@ extern "C" void render_clockify_widget(lv_obj_t *parent)
         }
         render_clockify_widget_box(parent);
 
+        // Render the last known data immediately, the tasks refresh it in the background
+        if (load_clockify_widget_state())
+        {
+            Serial.printf("Rendering cached clockify data from %s\n", format_data_age(clockify_widget_data.updated_at).c_str());
+        }
+
         if (!refresh_time_entries_in_progress) {
             refresh_time_entries_in_progress = true;
             xTaskCreate(refresh_time_entries_task_func, "RefreshTimeEntries", 8192, NULL, 1, &refresh_time_entries_task);
         }
-       
+        connectivity_subscribe(on_clockify_widget_connectivity_changed);
+
         init_render_clockify = false;
     }
 
+    if (clockify_refresh_requested && !refresh_time_entries_in_progress)
+    {
+        clockify_refresh_requested = false;
+        refresh_time_entries_in_progress = true;
+        xTaskCreate(refresh_time_entries_task_func, "RefreshTimeEntries", 8192, NULL, 1, &refresh_time_entries_task);
+    }
+
     if (is_clockify_widget_data_changed() == false)
     {
         return;
@@ -786,8 +1197,16 @@ extern "C" void render_clockify_widget(lv_obj_t *parent)
         }
     }
 
+    bool entries_changed = is_clockify_widget_data_changed_in_progress_entry() || is_clockify_widget_data_changed_time_entries();
+
     render_in_progress_box_entry();
     render_timer_entries_list_box();
+    render_clockify_data_age();
+
+    if (entries_changed && !clockify_widget_data.is_cached && !clockify_widget_data.entries_list_is_loading)
+    {
+        save_clockify_widget_state();
+    }
 
     clockify_widget_data_prev = clockify_widget_data;
 }
@@ -13,4 +13,92 @@
 #endif
 #ifndef STOCK_API_KEY
 #error "Stock api key missing"
-#endif
\ No newline at end of file
+#endif
+
+// optional parameters, can be overridden from the ini the same way
+// retries after the first attempt of a single request, 0 disables retrying
+#ifndef HTTP_RETRY_BUDGET
+#define HTTP_RETRY_BUDGET 2
+#endif
+#ifndef HTTP_BACKOFF_BASE_MS
+#define HTTP_BACKOFF_BASE_MS 1000
+#endif
+#ifndef HTTP_BACKOFF_MAX_MS
+#define HTTP_BACKOFF_MAX_MS 60000
+#endif
+// consecutive failures before a host is considered down
+#ifndef HTTP_CIRCUIT_FAILURE_THRESHOLD
+#define HTTP_CIRCUIT_FAILURE_THRESHOLD 5
+#endif
+#ifndef HTTP_CIRCUIT_OPEN_MS
+#define HTTP_CIRCUIT_OPEN_MS 60000
+#endif
+// deadline of a whole request including retries
+#ifndef HTTP_REQUEST_TIMEOUT_MS
+#define HTTP_REQUEST_TIMEOUT_MS 20000
+#endif
+// ask servers for gzip/deflate responses, they are inflated while parsing
+#ifndef HTTP_ACCEPT_COMPRESSION
+#define HTTP_ACCEPT_COMPRESSION 1
+#endif
+// days of daily bars cached per ticker, only bars newer than the cache are downloaded
+#ifndef STOCK_HISTORY_DAYS
+#define STOCK_HISTORY_DAYS 1826
+#endif
+// comma separated tickers of the stock widget, tap the widget to page through them
+#ifndef STOCK_WATCHLIST
+#define STOCK_WATCHLIST "TSLA"
+#endif
+// upper bound of the watchlist, the entries are allocated once at boot
+#ifndef STOCK_WATCHLIST_MAX
+#define STOCK_WATCHLIST_MAX 20
+#endif
+// the stock widget pages to the next ticker on its own this often, 0 disables it
+#ifndef STOCK_WATCHLIST_CYCLE_MS
+#define STOCK_WATCHLIST_CYCLE_MS 15000
+#endif
+// the ticker on screen is polled this often between watchlist refreshes and patched in place, 0 disables it.
+// only through the gateway or a source without network, direct fmp requests are left to the 15 minute batch
+#ifndef STOCK_LIVE_QUOTE_MS
+#define STOCK_LIVE_QUOTE_MS 60000
+#endif
+// 1 draws the stock chart as daily candles, 0 as a line through the opens and closes. the line stays the
+// default until chart bench has measured the candles on the device, a live quote re-rasterizes all of them
+#ifndef STOCK_CHART_CANDLES
+#define STOCK_CHART_CANDLES 0
+#endif
+// overlays of the stock chart, any of STOCK_INDICATOR_SMA, _EMA, _BOLLINGER and _VWAP or 0, see stock_indicators.h
+#ifndef STOCK_CHART_INDICATORS
+#define STOCK_CHART_INDICATORS (STOCK_INDICATOR_SMA | STOCK_INDICATOR_BOLLINGER)
+#endif
+// 1 refreshes the stock widget around the NYSE/NASDAQ sessions only: at the normal cadence while the market
+// is open, once after the close and not at all while it is closed. 0 refreshes around the clock
+#ifndef STOCK_MARKET_HOURS
+#define STOCK_MARKET_HOURS 1
+#endif
+// where the stock widget gets its data: live, fixture, replay or synthetic, see stock_data_source.h
+#ifndef STOCK_DATA_SOURCE
+#define STOCK_DATA_SOURCE "live"
+#endif
+// psram arenas the json responses are decoded into, one per request in flight
+#ifndef JSON_ARENA_COUNT
+#define JSON_ARENA_COUNT 3
+#endif
+#ifndef JSON_ARENA_SIZE
+#define JSON_ARENA_SIZE (256 * 1024)
+#endif
+// RADIO_POWER_PERFORMANCE, RADIO_POWER_BALANCED or RADIO_POWER_SAVER, see radio_power.h
+#ifndef RADIO_POWER_PROFILE
+#define RADIO_POWER_PROFILE RADIO_POWER_BALANCED
+#endif
+// base url of tools/gateway, e.g. "http://192.168.1.10:8090", empty to talk to the apis directly
+#ifndef GATEWAY_URL
+#define GATEWAY_URL ""
+#endif
+// api base urls, point them to tools/mock_api to run without api keys
+#ifndef CLOCKIFY_API_BASE_URL
+#define CLOCKIFY_API_BASE_URL "https://api.clockify.me/api/v1"
+#endif
+#ifndef STOCK_API_BASE_URL
+#define STOCK_API_BASE_URL "https://financialmodelingprep.com/stable"
+#endif
@@ -0,0 +1,379 @@
+#include <Arduino.h>
+#include <WiFi.h>
+#include <Preferences.h>
+#include <esp_attr.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/event_groups.h>
+#include <freertos/semphr.h>
+#include "connectivity.h"
+#include "clock_sync.h"
+#include "radio_power.h"
+#include "utils.h"
+
+const int CONNECTIVITY_TASK_FREQ_MS = 250;
+const uint32_t WIFI_CONNECT_TIMEOUT_MS = 15000;
+const uint32_t WIFI_FAST_CONNECT_TIMEOUT_MS = 3000;
+const time_t WIFI_IP_LEASE_REUSE_SEC = 12 * 60 * 60; // reuse a cached address only while the lease is likely still ours
+const uint32_t WIFI_CONNECTION_CACHE_MAGIC = 0x57494631;
+const char *WIFI_CONNECTION_CACHE_NAMESPACE = "wifi_cache";
+const uint32_t WIFI_RECONNECT_MIN_DELAY_MS = 1000;
+const uint32_t WIFI_RECONNECT_MAX_DELAY_MS = 30000;
+const int MAX_CONNECTIVITY_LISTENERS = 8;
+
+const EventBits_t CONNECTIVITY_ONLINE_BIT = BIT0;
+const EventBits_t CONNECTIVITY_CLOCK_VALID_BIT = BIT1;
+const EventBits_t CONNECTIVITY_TIME_SYNCED_BIT = BIT2;
+
+static EventGroupHandle_t connectivity_event_group = xEventGroupCreate();
+static TaskHandle_t connectivity_task = NULL;
+static volatile connectivity_state current_connectivity_state = CONNECTIVITY_OFFLINE;
+static volatile bool wifi_associated = false;
+static connectivity_listener connectivity_listeners[MAX_CONNECTIVITY_LISTENERS];
+static int connectivity_listeners_count = 0;
+static SemaphoreHandle_t connectivity_listeners_mutex = xSemaphoreCreateMutex();
+
+// Last successful connection, kept in RTC memory across deep sleep and in NVS across power loss
+struct wifi_connection_cache
+{
+    uint32_t magic;
+    uint8_t bssid[6];
+    int32_t channel;
+    uint32_t ip;
+    uint32_t gateway;
+    uint32_t subnet;
+    uint32_t dns;
+    time_t saved_at;
+};
+
+RTC_DATA_ATTR static wifi_connection_cache rtc_wifi_connection_cache;
+static bool fast_connect_failed = false;
+static bool fast_connect_attempt = false;
+static bool fast_connect_reused_ip = false;
+
+static const char *connectivity_ssid;
+static const char *connectivity_password;
+static const char *connectivity_ntp_server;
+static long connectivity_gmt_offset_sec;
+static int connectivity_daylight_offset_sec;
+
+static bool load_wifi_connection_cache(void)
+{
+    if (rtc_wifi_connection_cache.magic == WIFI_CONNECTION_CACHE_MAGIC)
+    {
+        return true;
+    }
+
+    Preferences preferences;
+    if (!preferences.begin(WIFI_CONNECTION_CACHE_NAMESPACE, true))
+    {
+        return false;
+    }
+    wifi_connection_cache cache = {};
+    bool loaded = preferences.getBytes("ap", &cache, sizeof(cache)) == sizeof(cache) && cache.magic == WIFI_CONNECTION_CACHE_MAGIC;
+    preferences.end();
+    if (loaded)
+    {
+        rtc_wifi_connection_cache = cache;
+    }
+    return loaded;
+}
+
+// A lease only starts when DHCP ran, a connection on the reused address keeps the time of the last lease
+static void save_wifi_connection_cache(bool leased)
+{
+    wifi_connection_cache cache = {
+        .magic = WIFI_CONNECTION_CACHE_MAGIC,
+        .bssid = {},
+        .channel = WiFi.channel(),
+        .ip = (uint32_t)WiFi.localIP(),
+        .gateway = (uint32_t)WiFi.gatewayIP(),
+        .subnet = (uint32_t)WiFi.subnetMask(),
+        .dns = (uint32_t)WiFi.dnsIP(0),
+        .saved_at = leased ? time(nullptr) : rtc_wifi_connection_cache.saved_at,
+    };
+    memcpy(cache.bssid, WiFi.BSSID(), sizeof(cache.bssid));
+
+    // Only the connection parameters matter for flash writes, not the timestamp
+    bool changed = memcmp(cache.bssid, rtc_wifi_connection_cache.bssid, sizeof(cache.bssid)) != 0 ||
+                   cache.channel != rtc_wifi_connection_cache.channel || cache.ip != rtc_wifi_connection_cache.ip ||
+                   cache.gateway != rtc_wifi_connection_cache.gateway || rtc_wifi_connection_cache.magic != WIFI_CONNECTION_CACHE_MAGIC;
+    bool lease_renewed = is_time_valid(cache.saved_at) && cache.saved_at - rtc_wifi_connection_cache.saved_at > WIFI_IP_LEASE_REUSE_SEC / 2;
+    rtc_wifi_connection_cache = cache;
+    if (!changed && !lease_renewed)
+    {
+        return;
+    }
+
+    Preferences preferences;
+    if (preferences.begin(WIFI_CONNECTION_CACHE_NAMESPACE, false))
+    {
+        preferences.putBytes("ap", &cache, sizeof(cache));
+        preferences.end();
+    }
+}
+
+static void clear_wifi_connection_cache(void)
+{
+    rtc_wifi_connection_cache = {};
+    Preferences preferences;
+    if (preferences.begin(WIFI_CONNECTION_CACHE_NAMESPACE, false))
+    {
+        preferences.remove("ap");
+        preferences.end();
+    }
+}
+
+// Joins the cached access point directly on its channel, without a scan, and with the cached
+// address when the lease is recent, without DHCP
+static bool begin_wifi_fast_connect(void)
+{
+    if (fast_connect_failed || !load_wifi_connection_cache())
+    {
+        return false;
+    }
+
+    const wifi_connection_cache &cache = rtc_wifi_connection_cache;
+    time_t now = time(nullptr);
+    bool reuse_ip = is_time_valid(now) && is_time_valid(cache.saved_at) && now - cache.saved_at < WIFI_IP_LEASE_REUSE_SEC;
+    if (reuse_ip)
+    {
+        WiFi.config(IPAddress(cache.ip), IPAddress(cache.gateway), IPAddress(cache.subnet), IPAddress(cache.dns));
+    }
+    fast_connect_reused_ip = reuse_ip;
+    Serial.printf("WiFi fast connect on channel %d%s\n", cache.channel, reuse_ip ? " with cached ip" : "");
+    WiFi.begin(connectivity_ssid, connectivity_password, cache.channel, cache.bssid);
+    return true;
+}
+
+// Widgets subscribe from the main task while this runs on the connectivity task. The listeners are called
+// outside the lock, so they may subscribe themselves
+static void publish_connectivity_state(connectivity_state state)
+{
+    connectivity_listener listeners[MAX_CONNECTIVITY_LISTENERS];
+    xSemaphoreTake(connectivity_listeners_mutex, portMAX_DELAY);
+    int count = connectivity_listeners_count;
+    memcpy(listeners, connectivity_listeners, count * sizeof(connectivity_listener));
+    xSemaphoreGive(connectivity_listeners_mutex);
+
+    for (int i = 0; i < count; i++)
+    {
+        listeners[i](state);
+    }
+}
+
+static void set_connectivity_state(connectivity_state state)
+{
+    if (current_connectivity_state == state)
+    {
+        return;
+    }
+    Serial.printf("Connectivity: %s -> %s\n", connectivity_state_str(current_connectivity_state), connectivity_state_str(state));
+    current_connectivity_state = state;
+    if (state == CONNECTIVITY_ONLINE)
+    {
+        xEventGroupSetBits(connectivity_event_group, CONNECTIVITY_ONLINE_BIT);
+    }
+    else
+    {
+        xEventGroupClearBits(connectivity_event_group, CONNECTIVITY_ONLINE_BIT);
+    }
+    publish_connectivity_state(state);
+}
+
+static void on_wifi_event(arduino_event_id_t event)
+{
+    switch (event)
+    {
+    case ARDUINO_EVENT_WIFI_STA_CONNECTED:
+        wifi_associated = true;
+        break;
+    case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+        wifi_associated = false;
+        break;
+    default:
+        return;
+    }
+    if (connectivity_task != NULL)
+    {
+        xTaskNotifyGive(connectivity_task);
+    }
+}
+
+static void on_time_synced(void)
+{
+    xEventGroupSetBits(connectivity_event_group, CONNECTIVITY_TIME_SYNCED_BIT);
+    if (connectivity_task != NULL)
+    {
+        xTaskNotifyGive(connectivity_task);
+    }
+}
+
+static void connectivity_task_func(void *parameter)
+{
+    uint32_t attempt_started_ms = 0;
+    uint32_t next_attempt_ms = 0;
+    uint32_t reconnect_delay_ms = WIFI_RECONNECT_MIN_DELAY_MS;
+    bool sntp_started = false;
+
+    while (true)
+    {
+        uint32_t now = millis();
+        bool has_ip = WiFi.status() == WL_CONNECTED && WiFi.localIP() != IPAddress((uint32_t)0);
+
+        switch (current_connectivity_state)
+        {
+        case CONNECTIVITY_OFFLINE:
+            if ((int32_t)(now - next_attempt_ms) >= 0)
+            {
+                // Back to DHCP, a static address is only set again for a fast connect with a recent lease
+                WiFi.config(IPAddress((uint32_t)0), IPAddress((uint32_t)0), IPAddress((uint32_t)0));
+                fast_connect_reused_ip = false;
+                fast_connect_attempt = begin_wifi_fast_connect();
+                if (!fast_connect_attempt)
+                {
+                    WiFi.begin(connectivity_ssid, connectivity_password);
+                }
+                attempt_started_ms = now;
+                set_connectivity_state(CONNECTIVITY_CONNECTING);
+            }
+            break;
+        case CONNECTIVITY_CONNECTING:
+        case CONNECTIVITY_OBTAINING_IP:
+            if (has_ip)
+            {
+                Serial.printf("Connected to WiFi network with IP Address: %s in %u ms (%s), %u ms after boot\n", WiFi.localIP().toString().c_str(),
+                              now - attempt_started_ms, fast_connect_attempt ? "fast connect" : "full scan", now);
+                reconnect_delay_ms = WIFI_RECONNECT_MIN_DELAY_MS;
+                fast_connect_failed = false;
+                save_wifi_connection_cache(!fast_connect_reused_ip);
+                set_connectivity_state(CONNECTIVITY_ONLINE);
+                if (!sntp_started)
+                {
+                    clock_sync_start_sntp(connectivity_ntp_server, connectivity_gmt_offset_sec, connectivity_daylight_offset_sec, on_time_synced);
+                    sntp_started = true;
+                }
+            }
+            else if (fast_connect_attempt && now - attempt_started_ms > WIFI_FAST_CONNECT_TIMEOUT_MS)
+            {
+                // The access point moved or the lease is gone, fall back to a full scan right away
+                Serial.println("WiFi fast connect failed, falling back to a full scan");
+                WiFi.disconnect();
+                fast_connect_failed = true;
+                clear_wifi_connection_cache();
+                next_attempt_ms = now;
+                set_connectivity_state(CONNECTIVITY_OFFLINE);
+            }
+            else if (now - attempt_started_ms > WIFI_CONNECT_TIMEOUT_MS)
+            {
+                Serial.printf("WiFi connect timed out, retrying in %u ms\n", reconnect_delay_ms);
+                WiFi.disconnect();
+                next_attempt_ms = now + reconnect_delay_ms;
+                reconnect_delay_ms = min(reconnect_delay_ms * 2, WIFI_RECONNECT_MAX_DELAY_MS);
+                set_connectivity_state(CONNECTIVITY_OFFLINE);
+            }
+            else if (wifi_associated)
+            {
+                set_connectivity_state(CONNECTIVITY_OBTAINING_IP);
+            }
+            break;
+        case CONNECTIVITY_ONLINE:
+            if (!has_ip)
+            {
+                Serial.println("WiFi connection lost, reconnecting");
+                WiFi.disconnect();
+                next_attempt_ms = now;
+                set_connectivity_state(CONNECTIVITY_OFFLINE);
+            }
+            break;
+        }
+
+        clock_sync_update();
+        radio_power_update();
+        if (!connectivity_is_clock_valid() && is_time_valid(time(nullptr)))
+        {
+            xEventGroupSetBits(connectivity_event_group, CONNECTIVITY_CLOCK_VALID_BIT);
+            Serial.println("Clock is valid");
+            publish_connectivity_state(current_connectivity_state);
+        }
+
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(CONNECTIVITY_TASK_FREQ_MS));
+    }
+}
+
+void connectivity_begin(const char *ssid, const char *password, const char *ntp_server, long gmt_offset_sec, int daylight_offset_sec)
+{
+    if (connectivity_task != NULL)
+    {
+        return;
+    }
+    connectivity_ssid = ssid;
+    connectivity_password = password;
+    connectivity_ntp_server = ntp_server;
+    connectivity_gmt_offset_sec = gmt_offset_sec;
+    connectivity_daylight_offset_sec = daylight_offset_sec;
+
+    WiFi.mode(WIFI_STA);
+    WiFi.setAutoReconnect(false); // reconnects are scheduled by the connectivity task
+    WiFi.onEvent(on_wifi_event);
+    xTaskCreate(connectivity_task_func, "Connectivity", 4096, NULL, 2, &connectivity_task);
+}
+
+bool connectivity_subscribe(connectivity_listener listener)
+{
+    xSemaphoreTake(connectivity_listeners_mutex, portMAX_DELAY);
+    bool has_room = connectivity_listeners_count < MAX_CONNECTIVITY_LISTENERS;
+    if (has_room)
+    {
+        connectivity_listeners[connectivity_listeners_count++] = listener;
+    }
+    xSemaphoreGive(connectivity_listeners_mutex);
+    if (!has_room)
+    {
+        Serial.println("Too many connectivity listeners");
+    }
+    return has_room;
+}
+
+connectivity_state connectivity_get_state(void)
+{
+    return current_connectivity_state;
+}
+
+const char *connectivity_state_str(connectivity_state state)
+{
+    switch (state)
+    {
+    case CONNECTIVITY_OFFLINE:
+        return "offline";
+    case CONNECTIVITY_CONNECTING:
+        return "connecting";
+    case CONNECTIVITY_OBTAINING_IP:
+        return "obtaining ip";
+    case CONNECTIVITY_ONLINE:
+        return "online";
+    }
+    return "unknown";
+}
+
+bool connectivity_is_online(void)
+{
+    return xEventGroupGetBits(connectivity_event_group) & CONNECTIVITY_ONLINE_BIT;
+}
+
+bool connectivity_is_clock_valid(void)
+{
+    return xEventGroupGetBits(connectivity_event_group) & CONNECTIVITY_CLOCK_VALID_BIT;
+}
+
+bool connectivity_is_time_synced(void)
+{
+    return xEventGroupGetBits(connectivity_event_group) & CONNECTIVITY_TIME_SYNCED_BIT;
+}
+
+bool connectivity_wait_online(uint32_t timeout_ms)
+{
+    const EventBits_t bits = CONNECTIVITY_ONLINE_BIT | CONNECTIVITY_CLOCK_VALID_BIT;
+    TickType_t timeout = (timeout_ms == UINT32_MAX) ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
+    return (xEventGroupWaitBits(connectivity_event_group, bits, pdFALSE, pdTRUE, timeout) & bits) == bits;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+
+enum connectivity_state
+{
+    CONNECTIVITY_OFFLINE,      // not associated, a (re)connect is scheduled
+    CONNECTIVITY_CONNECTING,   // joining the access point
+    CONNECTIVITY_OBTAINING_IP, // associated, waiting for DHCP
+    CONNECTIVITY_ONLINE,       // has an IP address
+};
+
+// Called from the connectivity task on every state change and when the clock becomes valid,
+// listeners must be short and must take the lvgl lock before touching objects
+typedef void (*connectivity_listener)(connectivity_state state);
+
+void connectivity_begin(const char *ssid, const char *password, const char *ntp_server, long gmt_offset_sec, int daylight_offset_sec);
+bool connectivity_subscribe(connectivity_listener listener);
+connectivity_state connectivity_get_state(void);
+const char *connectivity_state_str(connectivity_state state);
+bool connectivity_is_online(void);
+bool connectivity_is_clock_valid(void);
+bool connectivity_is_time_synced(void);
+// Blocks until online with a valid clock, every api request needs both
+bool connectivity_wait_online(uint32_t timeout_ms);
@@ -0,0 +1,173 @@
+#include <lvgl.h>
+#include <Arduino.h>
+#include "diagnostics_widget.h"
+#include <WiFi.h>
+#include "http_policy.h"
+#include "http_inflate.h"
+#include "http_metrics.h"
+#include "json_arena.h"
+#include "connectivity.h"
+#include "radio_power.h"
+#include "utils.h"
+
+lv_obj_t *diagnostics_widget_box;
+lv_obj_t *connectivity_label;
+lv_obj_t *radio_power_label;
+lv_obj_t *http_transfer_label;
+lv_obj_t *json_arena_label;
+lv_obj_t *http_policy_table;
+lv_obj_t *http_latency_table;
+
+const int REFRESH_DIAGNOSTICS_WIDGET_FREQ_MS = 1000;
+static uint32_t last_diagnostics_update_ms = 0;
+
+void render_diagnostics_widget(lv_obj_t *parent)
+{
+    if (parent == nullptr)
+    {
+        parent = lv_screen_active();
+    }
+
+    diagnostics_widget_box = create_lv_div(parent);
+    lv_obj_set_size(diagnostics_widget_box, lv_pct(100), lv_pct(100));
+    lv_obj_set_style_radius(diagnostics_widget_box, 16, LV_PART_MAIN);
+    lv_obj_set_style_bg_color(diagnostics_widget_box, lv_palette_darken(LV_PALETTE_GREY, 4), LV_PART_MAIN);
+    lv_obj_set_flex_flow(diagnostics_widget_box, LV_FLEX_FLOW_COLUMN);
+    lv_obj_set_style_pad_all(diagnostics_widget_box, 5, LV_PART_MAIN);
+    lv_obj_add_flag(diagnostics_widget_box, LV_OBJ_FLAG_SCROLLABLE);
+
+    lv_obj_t *title_label = lv_label_create(diagnostics_widget_box);
+    lv_label_set_text(title_label, "Network");
+    lv_obj_set_style_text_font(title_label, &lv_font_montserrat_20, 0);
+    lv_obj_set_style_text_color(title_label, lv_color_white(), 0);
+
+    connectivity_label = lv_label_create(diagnostics_widget_box);
+    lv_obj_set_style_text_font(connectivity_label, &lv_font_montserrat_14, 0);
+    lv_obj_set_style_text_color(connectivity_label, lv_palette_lighten(LV_PALETTE_GREY, 1), 0);
+
+    radio_power_label = lv_label_create(diagnostics_widget_box);
+    lv_obj_set_style_text_font(radio_power_label, &lv_font_montserrat_14, 0);
+    lv_obj_set_style_text_color(radio_power_label, lv_palette_lighten(LV_PALETTE_GREY, 1), 0);
+
+    http_transfer_label = lv_label_create(diagnostics_widget_box);
+    lv_obj_set_style_text_font(http_transfer_label, &lv_font_montserrat_14, 0);
+    lv_obj_set_style_text_color(http_transfer_label, lv_palette_lighten(LV_PALETTE_GREY, 1), 0);
+
+    json_arena_label = lv_label_create(diagnostics_widget_box);
+    lv_obj_set_style_text_font(json_arena_label, &lv_font_montserrat_14, 0);
+    lv_obj_set_style_text_color(json_arena_label, lv_palette_lighten(LV_PALETTE_GREY, 1), 0);
+
+    http_policy_table = lv_table_create(diagnostics_widget_box);
+    lv_obj_add_flag(http_policy_table, LV_OBJ_FLAG_EVENT_BUBBLE);
+    lv_obj_set_width(http_policy_table, lv_pct(100));
+    lv_obj_set_style_text_font(http_policy_table, &lv_font_montserrat_14, LV_PART_ITEMS);
+    lv_obj_set_style_pad_all(http_policy_table, 4, LV_PART_ITEMS);
+    lv_table_set_column_count(http_policy_table, 5);
+    lv_table_set_column_width(http_policy_table, 0, 190);
+    lv_table_set_column_width(http_policy_table, 1, 90);
+    lv_table_set_column_width(http_policy_table, 2, 70);
+    lv_table_set_column_width(http_policy_table, 3, 80);
+    lv_table_set_column_width(http_policy_table, 4, 70);
+    lv_table_set_cell_value(http_policy_table, 0, 0, "Host");
+    lv_table_set_cell_value(http_policy_table, 0, 1, "Circuit");
+    lv_table_set_cell_value(http_policy_table, 0, 2, "Tokens");
+    lv_table_set_cell_value(http_policy_table, 0, 3, "Fail/Req");
+    lv_table_set_cell_value(http_policy_table, 0, 4, "Skip");
+
+    lv_obj_t *latency_label = lv_label_create(diagnostics_widget_box);
+    lv_label_set_text(latency_label, "Median ms over the last requests, serial \"net\" has the histograms");
+    lv_obj_set_style_text_font(latency_label, &lv_font_montserrat_14, 0);
+    lv_obj_set_style_text_color(latency_label, lv_palette_lighten(LV_PALETTE_GREY, 1), 0);
+
+    http_latency_table = lv_table_create(diagnostics_widget_box);
+    lv_obj_add_flag(http_latency_table, LV_OBJ_FLAG_EVENT_BUBBLE);
+    lv_obj_set_width(http_latency_table, lv_pct(100));
+    lv_obj_set_style_text_font(http_latency_table, &lv_font_montserrat_14, LV_PART_ITEMS);
+    lv_obj_set_style_pad_all(http_latency_table, 4, LV_PART_ITEMS);
+    lv_table_set_column_count(http_latency_table, 7);
+    lv_table_set_column_width(http_latency_table, 0, 150);
+    for (uint32_t column = 1; column < 6; column++)
+    {
+        lv_table_set_column_width(http_latency_table, column, 62);
+    }
+    lv_table_set_column_width(http_latency_table, 6, 50);
+    lv_table_set_cell_value(http_latency_table, 0, 0, "Endpoint");
+    lv_table_set_cell_value(http_latency_table, 0, 1, "DNS");
+    lv_table_set_cell_value(http_latency_table, 0, 2, "Conn");
+    lv_table_set_cell_value(http_latency_table, 0, 3, "TTFB");
+    lv_table_set_cell_value(http_latency_table, 0, 4, "Body");
+    lv_table_set_cell_value(http_latency_table, 0, 5, "Parse");
+    lv_table_set_cell_value(http_latency_table, 0, 6, "Err");
+
+    last_diagnostics_update_ms = 0;
+    update_diagnostics_widget();
+}
+
+void update_diagnostics_widget(void)
+{
+    if (http_policy_table == nullptr || millis() - last_diagnostics_update_ms < REFRESH_DIAGNOSTICS_WIDGET_FREQ_MS)
+    {
+        return;
+    }
+    last_diagnostics_update_ms = millis();
+
+    connectivity_state state = connectivity_get_state();
+    lv_label_set_text_fmt(connectivity_label, "%s WiFi %s, %s, %d dBm, clock %s", LV_SYMBOL_WIFI, connectivity_state_str(state),
+                          state == CONNECTIVITY_ONLINE ? WiFi.localIP().toString().c_str() : "no ip",
+                          state == CONNECTIVITY_ONLINE ? WiFi.RSSI() : 0,
+                          connectivity_is_time_synced() ? "synced" : (connectivity_is_clock_valid() ? "valid" : "not set"));
+
+    radio_power_stats radio = radio_power_get_stats();
+    lv_label_set_text_fmt(radio_power_label, "Radio %s (%s), on %us this hour, %us last hour, %u wakeups", radio.awake ? "awake" : "modem sleep",
+                          radio_power_profile_str(radio.profile), radio.awake_ms_this_hour / 1000, radio.awake_ms_last_hour / 1000, radio.wakeups);
+
+    http_transfer_stats transfer = http_transfer_get_stats();
+    lv_label_set_text_fmt(http_transfer_label, "HTTP %u responses (%u compressed), %u KB received for %u KB decoded, inflate %u ms",
+                          transfer.responses, transfer.compressed_responses, (uint32_t)(transfer.wire_bytes / 1024),
+                          (uint32_t)(transfer.body_bytes / 1024), (uint32_t)(transfer.inflate_us / 1000));
+
+    json_arena_stats arenas = json_arena_get_stats();
+    lv_label_set_text_fmt(json_arena_label, "JSON arenas %u/%u in use, peak %u of %u KB, %u resets, %u spills, %u exhausted, heap %u KB free",
+                          arenas.in_use, arenas.arenas, arenas.peak_bytes / 1024, arenas.arena_size / 1024, arenas.resets, arenas.spills,
+                          arenas.exhausted, ESP.getFreeHeap() / 1024);
+
+    std::vector<http_host_policy_state> hosts = http_policy_snapshot();
+    lv_table_set_row_count(http_policy_table, hosts.size() + 1);
+    for (size_t i = 0; i < hosts.size(); i++)
+    {
+        const http_host_policy_state &host = hosts[i];
+        uint32_t row = i + 1;
+        lv_table_set_cell_value(http_policy_table, row, 0, host.host.c_str());
+        lv_table_set_cell_value(http_policy_table, row, 1, http_circuit_state_str(host.circuit));
+        lv_table_set_cell_value_fmt(http_policy_table, row, 2, "%d/%d", (int)host.tokens, (int)host.capacity);
+        lv_table_set_cell_value_fmt(http_policy_table, row, 3, "%u/%u", host.failures, host.requests);
+        lv_table_set_cell_value_fmt(http_policy_table, row, 4, "%u", host.rate_limited + host.short_circuited);
+    }
+
+    std::vector<http_endpoint_metrics> endpoints = http_metrics_snapshot();
+    lv_table_set_row_count(http_latency_table, endpoints.size() + 1);
+    for (size_t i = 0; i < endpoints.size(); i++)
+    {
+        const http_endpoint_metrics &endpoint = endpoints[i];
+        uint32_t row = i + 1;
+        // tcp for plain http, tcp and tls together for https
+        uint16_t connect_ms = endpoint.p50_ms[HTTP_PHASE_TLS] != HTTP_PHASE_NOT_MEASURED ? endpoint.p50_ms[HTTP_PHASE_TLS] : endpoint.p50_ms[HTTP_PHASE_TCP];
+        const uint16_t columns_ms[] = {endpoint.p50_ms[HTTP_PHASE_DNS], connect_ms, endpoint.p50_ms[HTTP_PHASE_TTFB],
+                                       endpoint.p50_ms[HTTP_PHASE_BODY], endpoint.p50_ms[HTTP_PHASE_PARSE]};
+        uint32_t errors = endpoint.requests - endpoint.errors[HTTP_ERROR_NONE];
+
+        lv_table_set_cell_value(http_latency_table, row, 0, endpoint.name.c_str());
+        for (uint32_t column = 0; column < 5; column++)
+        {
+            if (columns_ms[column] == HTTP_PHASE_NOT_MEASURED)
+            {
+                lv_table_set_cell_value(http_latency_table, row, column + 1, "-");
+            }
+            else
+            {
+                lv_table_set_cell_value_fmt(http_latency_table, row, column + 1, "%u", columns_ms[column]);
+            }
+        }
+        lv_table_set_cell_value_fmt(http_latency_table, row, 6, "%u", errors);
+    }
+}
@@ -0,0 +1,40 @@
+/**
+ * @file diagnostics_widget.h
+ *
+ */
+
+#ifndef DIAGNOSTICS_WIDGET_H
+#define DIAGNOSTICS_WIDGET_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /*********************
+     *      INCLUDES
+     *********************/
+
+    /*********************
+     *      DEFINES
+     *********************/
+
+    /**********************
+     *      TYPEDEFS
+     **********************/
+
+    /**********************
+     * GLOBAL PROTOTYPES
+     **********************/
+    void render_diagnostics_widget(lv_obj_t *parent = nullptr);
+    void update_diagnostics_widget(void);
+
+    /**********************
+     *      MACROS
+     **********************/
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /*DIAGNOSTICS_WIDGET_H*/
@@ -0,0 +1,380 @@
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+#include <esp_rom_crc.h>
+#include <esp32s3/rom/miniz.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "http_inflate.h"
+
+const size_t INFLATE_INPUT_BUFFER_SIZE = 1024;
+const uint8_t GZIP_FLAG_HCRC = 0x02;
+const uint8_t GZIP_FLAG_EXTRA = 0x04;
+const uint8_t GZIP_FLAG_NAME = 0x08;
+const uint8_t GZIP_FLAG_COMMENT = 0x10;
+
+static SemaphoreHandle_t http_transfer_mutex = xSemaphoreCreateMutex();
+static http_transfer_stats transfer_stats = {};
+
+http_content_encoding http_content_encoding_from_header(const String &content_encoding)
+{
+    if (content_encoding.length() == 0 || content_encoding.equalsIgnoreCase("identity"))
+    {
+        return HTTP_ENCODING_IDENTITY;
+    }
+    if (content_encoding.equalsIgnoreCase("gzip") || content_encoding.equalsIgnoreCase("x-gzip"))
+    {
+        return HTTP_ENCODING_GZIP;
+    }
+    if (content_encoding.equalsIgnoreCase("deflate"))
+    {
+        return HTTP_ENCODING_DEFLATE;
+    }
+    return HTTP_ENCODING_UNSUPPORTED;
+}
+
+const char *http_content_encoding_str(http_content_encoding encoding)
+{
+    switch (encoding)
+    {
+    case HTTP_ENCODING_IDENTITY:
+        return "identity";
+    case HTTP_ENCODING_GZIP:
+        return "gzip";
+    case HTTP_ENCODING_DEFLATE:
+        return "deflate";
+    case HTTP_ENCODING_UNSUPPORTED:
+        return "unsupported";
+    }
+    return "unknown";
+}
+
+void http_transfer_record(http_content_encoding encoding, size_t wire_bytes, size_t body_bytes, uint32_t inflate_us)
+{
+    xSemaphoreTake(http_transfer_mutex, portMAX_DELAY);
+    transfer_stats.responses++;
+    if (encoding == HTTP_ENCODING_GZIP || encoding == HTTP_ENCODING_DEFLATE)
+    {
+        transfer_stats.compressed_responses++;
+    }
+    transfer_stats.wire_bytes += wire_bytes;
+    transfer_stats.body_bytes += body_bytes;
+    transfer_stats.inflate_us += inflate_us;
+    xSemaphoreGive(http_transfer_mutex);
+}
+
+http_transfer_stats http_transfer_get_stats(void)
+{
+    xSemaphoreTake(http_transfer_mutex, portMAX_DELAY);
+    http_transfer_stats stats = transfer_stats;
+    xSemaphoreGive(http_transfer_mutex);
+    return stats;
+}
+
+inflate_stream::inflate_stream(Stream &source, http_content_encoding encoding, const request_context *context)
+    : source(source), encoding(encoding), context(context)
+{
+    if (encoding == HTTP_ENCODING_IDENTITY)
+    {
+        return;
+    }
+    if (encoding == HTTP_ENCODING_UNSUPPORTED)
+    {
+        fail("unsupported content encoding");
+        return;
+    }
+
+    decompressor = (tinfl_decompressor *)malloc(sizeof(tinfl_decompressor));
+    // The window is only touched by back references, PSRAM is fast enough for it
+    window = (uint8_t *)heap_caps_malloc(TINFL_LZ_DICT_SIZE, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (window == nullptr)
+    {
+        window = (uint8_t *)malloc(TINFL_LZ_DICT_SIZE);
+    }
+    input = (uint8_t *)malloc(INFLATE_INPUT_BUFFER_SIZE);
+    if (decompressor == nullptr || window == nullptr || input == nullptr)
+    {
+        fail("not enough memory");
+        return;
+    }
+    tinfl_init(decompressor);
+}
+
+inflate_stream::~inflate_stream()
+{
+    free(decompressor);
+    heap_caps_free(window);
+    free(input);
+}
+
+void inflate_stream::fail(const char *reason)
+{
+    if (!failed)
+    {
+        Serial.printf("Reading %s response body failed: %s\n", http_content_encoding_str(encoding), reason);
+    }
+    failed = true;
+    output_pos = output_end;
+}
+
+bool inflate_stream::fill_input(void)
+{
+    if (input_eof)
+    {
+        return false;
+    }
+    if (context != nullptr && context->should_stop())
+    {
+        input_eof = true;
+        fail(context->stop_reason());
+        return false;
+    }
+    if (input_pos > 0)
+    {
+        memmove(input, input + input_pos, input_len - input_pos);
+        input_len -= input_pos;
+        input_pos = 0;
+    }
+
+    // Take what has arrived, or wait for at least one byte so the tail of the body is not held up by the timeout
+    size_t length = INFLATE_INPUT_BUFFER_SIZE - input_len;
+    int available = source.available();
+    length = available > 0 ? min(length, (size_t)available) : 1;
+    uint32_t started_us = micros();
+    size_t read = source.readBytes((char *)input + input_len, length);
+    read_us_ += micros() - started_us;
+    if (read == 0)
+    {
+        input_eof = true;
+        return false;
+    }
+    input_len += read;
+    wire_bytes_ += read;
+    return true;
+}
+
+bool inflate_stream::ensure_input(size_t length)
+{
+    while (input_len - input_pos < length)
+    {
+        if (!fill_input())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+int inflate_stream::next_input_byte(void)
+{
+    if (!ensure_input(1))
+    {
+        return -1;
+    }
+    return input[input_pos++];
+}
+
+bool inflate_stream::parse_header(void)
+{
+    header_parsed = true;
+    if (encoding == HTTP_ENCODING_DEFLATE)
+    {
+        // "deflate" is meant to be zlib wrapped (RFC 1950), but some servers send a raw deflate stream
+        if (!ensure_input(2))
+        {
+            return false;
+        }
+        uint8_t cmf = input[input_pos];
+        uint8_t flg = input[input_pos + 1];
+        bool zlib_wrapped = (cmf & 0x0f) == 8 && ((cmf << 8) | flg) % 31 == 0;
+        inflate_flags = zlib_wrapped ? TINFL_FLAG_PARSE_ZLIB_HEADER | TINFL_FLAG_COMPUTE_ADLER32 : 0;
+        return true;
+    }
+
+    // gzip member header, RFC 1952
+    if (!ensure_input(10) || input[input_pos] != 0x1f || input[input_pos + 1] != 0x8b || input[input_pos + 2] != 8)
+    {
+        return false;
+    }
+    uint8_t flags = input[input_pos + 3];
+    input_pos += 10;
+    if (flags & GZIP_FLAG_EXTRA)
+    {
+        if (!ensure_input(2))
+        {
+            return false;
+        }
+        size_t extra_length = input[input_pos] | (input[input_pos + 1] << 8);
+        input_pos += 2;
+        for (size_t i = 0; i < extra_length; i++)
+        {
+            if (next_input_byte() < 0)
+            {
+                return false;
+            }
+        }
+    }
+    for (uint8_t zero_terminated_field : {GZIP_FLAG_NAME, GZIP_FLAG_COMMENT})
+    {
+        if (flags & zero_terminated_field)
+        {
+            int c;
+            while ((c = next_input_byte()) > 0)
+            {
+            }
+            if (c < 0)
+            {
+                return false;
+            }
+        }
+    }
+    if (flags & GZIP_FLAG_HCRC)
+    {
+        if (!ensure_input(2))
+        {
+            return false;
+        }
+        input_pos += 2;
+    }
+    return true;
+}
+
+bool inflate_stream::check_gzip_trailer(void)
+{
+    if (!ensure_input(8))
+    {
+        return false;
+    }
+    const uint8_t *trailer = input + input_pos;
+    uint32_t expected_crc = trailer[0] | (trailer[1] << 8) | (trailer[2] << 16) | ((uint32_t)trailer[3] << 24);
+    uint32_t expected_size = trailer[4] | (trailer[5] << 8) | (trailer[6] << 16) | ((uint32_t)trailer[7] << 24);
+    input_pos += 8;
+    return expected_crc == crc && expected_size == (uint32_t)body_bytes_;
+}
+
+bool inflate_stream::fill_output(void)
+{
+    while (output_pos == output_end)
+    {
+        if (failed || finished)
+        {
+            return false;
+        }
+        if (!header_parsed && !parse_header())
+        {
+            fail("bad header");
+            return false;
+        }
+        if (input_pos == input_len)
+        {
+            fill_input();
+        }
+
+        size_t input_size = input_len - input_pos;
+        size_t output_size = TINFL_LZ_DICT_SIZE - window_pos;
+        uint32_t flags = inflate_flags | (input_eof ? 0 : TINFL_FLAG_HAS_MORE_INPUT);
+        uint32_t started_us = micros();
+        tinfl_status status = tinfl_decompress(decompressor, input + input_pos, &input_size, window, window + window_pos, &output_size, flags);
+        inflate_us_ += micros() - started_us;
+
+        input_pos += input_size;
+        output_pos = window_pos;
+        output_end = window_pos + output_size;
+        window_pos = output_end & (TINFL_LZ_DICT_SIZE - 1);
+        body_bytes_ += output_size;
+        if (encoding == HTTP_ENCODING_GZIP)
+        {
+            crc = esp_rom_crc32_le(crc, window + output_pos, output_size);
+        }
+
+        if (status < 0)
+        {
+            fail("corrupt stream");
+            return false;
+        }
+        if (status == TINFL_STATUS_DONE)
+        {
+            finished = true;
+            if (encoding == HTTP_ENCODING_GZIP && !check_gzip_trailer())
+            {
+                fail("checksum mismatch");
+                return false;
+            }
+        }
+        else if (status == TINFL_STATUS_NEEDS_MORE_INPUT && input_eof)
+        {
+            fail("truncated");
+            return false;
+        }
+    }
+    return true;
+}
+
+int inflate_stream::available()
+{
+    if (encoding == HTTP_ENCODING_IDENTITY)
+    {
+        return source.available();
+    }
+    return output_end - output_pos;
+}
+
+int inflate_stream::read()
+{
+    char c;
+    return readBytes(&c, 1) == 1 ? (uint8_t)c : -1;
+}
+
+int inflate_stream::peek()
+{
+    if (encoding == HTTP_ENCODING_IDENTITY)
+    {
+        return source.peek();
+    }
+    return fill_output() ? window[output_pos] : -1;
+}
+
+size_t inflate_stream::readBytes(char *buffer, size_t length)
+{
+    if (encoding == HTTP_ENCODING_IDENTITY)
+    {
+        if (context != nullptr && context->should_stop())
+        {
+            fail(context->stop_reason());
+            return 0;
+        }
+        uint32_t started_us = micros();
+        size_t read = source.readBytes(buffer, length);
+        read_us_ += micros() - started_us;
+        wire_bytes_ += read;
+        body_bytes_ += read;
+        return read;
+    }
+
+    size_t read = 0;
+    while (read < length && fill_output())
+    {
+        size_t chunk = min(length - read, output_end - output_pos);
+        memcpy(buffer + read, window + output_pos, chunk);
+        output_pos += chunk;
+        read += chunk;
+    }
+    return read;
+}
+
+bool inflate_stream::finish(void)
+{
+    if (encoding == HTTP_ENCODING_IDENTITY)
+    {
+        return ok();
+    }
+    while (fill_output())
+    {
+        output_pos = output_end;
+    }
+    return ok();
+}
+
+bool inflate_stream::ok(void) const
+{
+    return encoding == HTTP_ENCODING_IDENTITY ? !failed : finished && !failed;
+}
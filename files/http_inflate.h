@@ -0,0 +1,85 @@
+#pragma once
+
+#include <Arduino.h>
+#include <cstdint>
+#include "request_context.h"
+
+enum http_content_encoding
+{
+    HTTP_ENCODING_IDENTITY,
+    HTTP_ENCODING_GZIP,
+    HTTP_ENCODING_DEFLATE,
+    HTTP_ENCODING_UNSUPPORTED,
+};
+
+struct http_transfer_stats
+{
+    uint32_t responses;
+    uint32_t compressed_responses;
+    uint64_t wire_bytes; // response body bytes received, compressed or not
+    uint64_t body_bytes; // response body bytes after inflating
+    uint64_t inflate_us; // CPU time spent inflating
+};
+
+http_content_encoding http_content_encoding_from_header(const String &content_encoding);
+const char *http_content_encoding_str(http_content_encoding encoding);
+void http_transfer_record(http_content_encoding encoding, size_t wire_bytes, size_t body_bytes, uint32_t inflate_us);
+http_transfer_stats http_transfer_get_stats(void);
+
+// Reads a response body from the socket and inflates it on the fly, so deserializeJson can parse a gzip or
+// deflate body without it ever being held in RAM. Only the 32 KB deflate window and a small input buffer
+// are allocated. Identity bodies are passed through and only counted. Reading stops early once the request
+// context is cancelled or past its deadline.
+class inflate_stream : public Stream
+{
+public:
+    inflate_stream(Stream &source, http_content_encoding encoding, const request_context *context = nullptr);
+    ~inflate_stream();
+
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t readBytes(char *buffer, size_t length) override;
+    size_t write(uint8_t) override { return 0; }
+    void flush() override {}
+
+    // Inflates what the parser left unread and checks the gzip trailer, false if the body is corrupt or truncated
+    bool finish(void);
+    bool ok(void) const;
+    size_t wire_bytes(void) const { return wire_bytes_; }
+    size_t body_bytes(void) const { return body_bytes_; }
+    uint32_t inflate_us(void) const { return inflate_us_; }
+    // Time spent waiting on the source, the rest of a parse is cpu time
+    uint32_t read_us(void) const { return read_us_; }
+
+private:
+    bool fill_input(void);
+    bool ensure_input(size_t length);
+    int next_input_byte(void);
+    bool parse_header(void);
+    bool check_gzip_trailer(void);
+    bool fill_output(void);
+    void fail(const char *reason);
+
+    Stream &source;
+    http_content_encoding encoding;
+    const request_context *context;
+    struct tinfl_decompressor_tag *decompressor = nullptr;
+    uint8_t *window = nullptr;
+    uint8_t *input = nullptr;
+    size_t input_pos = 0;
+    size_t input_len = 0;
+    bool input_eof = false;
+    size_t window_pos = 0; // where the next inflated bytes are written, wraps around the window
+    size_t output_pos = 0; // inflated bytes not read yet are window[output_pos, output_end)
+    size_t output_end = 0;
+    uint32_t inflate_flags = 0;
+    bool header_parsed = false;
+    bool finished = false;
+    bool failed = false;
+    uint32_t crc = 0;
+    size_t wire_bytes_ = 0;
+    size_t body_bytes_ = 0;
+    uint32_t inflate_us_ = 0;
+    uint32_t read_us_ = 0;
+};
@@ -0,0 +1,249 @@
+#include <Arduino.h>
+#include <algorithm>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "http_metrics.h"
+
+const uint16_t HTTP_METRICS_BUCKET_LIMITS_MS[HTTP_METRICS_BUCKETS - 1] = {10, 20, 50, 100, 200, 500, 1000};
+
+const int MAX_HTTP_METRICS_ENDPOINTS = 8;
+
+struct http_endpoint_ring
+{
+    std::string host;
+    std::string name;
+    uint32_t requests;
+    uint32_t errors[HTTP_ERROR_COUNT];
+    uint32_t json_high_water;
+    http_request_sample samples[HTTP_METRICS_SAMPLES];
+    int next;  // slot the next sample is written to
+    int count; // samples in the ring, at most HTTP_METRICS_SAMPLES
+};
+
+static http_endpoint_ring http_metrics_endpoints[MAX_HTTP_METRICS_ENDPOINTS];
+static int http_metrics_endpoints_count = 0;
+static SemaphoreHandle_t http_metrics_mutex = xSemaphoreCreateMutex();
+
+std::string http_metrics_endpoint_name(const std::string &method, const std::string &url)
+{
+    // Ids in the path (workspace, user, symbol) would give every request its own endpoint, the last segment does not
+    size_t path_end = url.find('?');
+    std::string path = url.substr(0, path_end);
+    size_t segment = path.rfind('/');
+    size_t authority = path.find("://");
+    if (segment == std::string::npos || (authority != std::string::npos && segment < authority + 3))
+    {
+        return method + " /";
+    }
+    return method + " " + path.substr(segment);
+}
+
+http_request_sample http_metrics_new_sample(void)
+{
+    http_request_sample sample;
+    std::fill(sample.phase_ms, sample.phase_ms + HTTP_PHASE_COUNT, HTTP_PHASE_NOT_MEASURED);
+    sample.http_code = 0;
+    sample.rssi = 0;
+    sample.error = HTTP_ERROR_NONE;
+    sample.json_bytes = 0;
+    return sample;
+}
+
+// Must be called with http_metrics_mutex held
+static http_endpoint_ring *get_endpoint_ring(const std::string &host, const std::string &name)
+{
+    for (int i = 0; i < http_metrics_endpoints_count; i++)
+    {
+        if (http_metrics_endpoints[i].host == host && http_metrics_endpoints[i].name == name)
+        {
+            return &http_metrics_endpoints[i];
+        }
+    }
+
+    // Table full -> reuse the last slot, like the http policy table
+    int index = (http_metrics_endpoints_count < MAX_HTTP_METRICS_ENDPOINTS) ? http_metrics_endpoints_count++ : MAX_HTTP_METRICS_ENDPOINTS - 1;
+    http_endpoint_ring &ring = http_metrics_endpoints[index];
+    ring.host = host;
+    ring.name = name;
+    ring.requests = 0;
+    std::fill(ring.errors, ring.errors + HTTP_ERROR_COUNT, 0);
+    ring.json_high_water = 0;
+    ring.next = 0;
+    ring.count = 0;
+    return &ring;
+}
+
+void http_metrics_record(const std::string &host, const std::string &name, const http_request_sample &sample)
+{
+    xSemaphoreTake(http_metrics_mutex, portMAX_DELAY);
+    http_endpoint_ring *ring = get_endpoint_ring(host, name);
+    ring->requests++;
+    ring->errors[sample.error]++;
+    ring->json_high_water = max(ring->json_high_water, sample.json_bytes);
+    ring->samples[ring->next] = sample;
+    ring->next = (ring->next + 1) % HTTP_METRICS_SAMPLES;
+    ring->count = min(ring->count + 1, HTTP_METRICS_SAMPLES);
+    xSemaphoreGive(http_metrics_mutex);
+}
+
+static int bucket_index(uint16_t ms)
+{
+    for (int i = 0; i < HTTP_METRICS_BUCKETS - 1; i++)
+    {
+        if (ms < HTTP_METRICS_BUCKET_LIMITS_MS[i])
+        {
+            return i;
+        }
+    }
+    return HTTP_METRICS_BUCKETS - 1;
+}
+
+static http_endpoint_metrics summarize(const http_endpoint_ring &ring)
+{
+    http_endpoint_metrics metrics = {};
+    metrics.host = ring.host;
+    metrics.name = ring.name;
+    metrics.requests = ring.requests;
+    std::copy(ring.errors, ring.errors + HTTP_ERROR_COUNT, metrics.errors);
+    metrics.json_high_water = ring.json_high_water;
+    metrics.samples = ring.count;
+
+    int rssi_sum = 0;
+    for (int i = 0; i < ring.count; i++)
+    {
+        rssi_sum += ring.samples[i].rssi;
+    }
+    metrics.average_rssi = ring.count > 0 ? rssi_sum / ring.count : 0;
+    metrics.last_http_code = ring.count > 0 ? ring.samples[(ring.next + HTTP_METRICS_SAMPLES - 1) % HTTP_METRICS_SAMPLES].http_code : 0;
+
+    uint16_t values[HTTP_METRICS_SAMPLES];
+    for (int phase = 0; phase < HTTP_PHASE_COUNT; phase++)
+    {
+        int measured = 0;
+        for (int i = 0; i < ring.count; i++)
+        {
+            uint16_t ms = ring.samples[i].phase_ms[phase];
+            if (ms != HTTP_PHASE_NOT_MEASURED)
+            {
+                values[measured++] = ms;
+                metrics.histogram[phase][bucket_index(ms)]++;
+            }
+        }
+        if (measured == 0)
+        {
+            metrics.p50_ms[phase] = HTTP_PHASE_NOT_MEASURED;
+            metrics.p90_ms[phase] = HTTP_PHASE_NOT_MEASURED;
+            continue;
+        }
+        std::sort(values, values + measured);
+        metrics.p50_ms[phase] = values[(measured - 1) * 50 / 100];
+        metrics.p90_ms[phase] = values[(measured - 1) * 90 / 100];
+    }
+    return metrics;
+}
+
+std::vector<http_endpoint_metrics> http_metrics_snapshot(void)
+{
+    std::vector<http_endpoint_metrics> snapshot;
+    xSemaphoreTake(http_metrics_mutex, portMAX_DELAY);
+    for (int i = 0; i < http_metrics_endpoints_count; i++)
+    {
+        snapshot.push_back(summarize(http_metrics_endpoints[i]));
+    }
+    xSemaphoreGive(http_metrics_mutex);
+    return snapshot;
+}
+
+void http_metrics_reset(void)
+{
+    xSemaphoreTake(http_metrics_mutex, portMAX_DELAY);
+    http_metrics_endpoints_count = 0;
+    xSemaphoreGive(http_metrics_mutex);
+}
+
+void http_metrics_print(Print &out)
+{
+    std::vector<http_endpoint_metrics> endpoints = http_metrics_snapshot();
+    if (endpoints.empty())
+    {
+        out.println("No HTTP requests recorded yet");
+        return;
+    }
+
+    for (const http_endpoint_metrics &endpoint : endpoints)
+    {
+        out.printf("%s %s: %u requests, last %d, rssi %d dBm, json peak %u bytes, errors", endpoint.host.c_str(), endpoint.name.c_str(),
+                   endpoint.requests, endpoint.last_http_code, endpoint.average_rssi, endpoint.json_high_water);
+        for (int kind = HTTP_ERROR_DNS; kind < HTTP_ERROR_COUNT; kind++)
+        {
+            out.printf(" %s %u", http_error_kind_str((http_error_kind)kind), endpoint.errors[kind]);
+        }
+        out.printf("\n  %-15s %5s %5s", "ms", "p50", "p90");
+        char bucket_label[8];
+        for (int i = 0; i < HTTP_METRICS_BUCKETS; i++)
+        {
+            bool last = i == HTTP_METRICS_BUCKETS - 1;
+            snprintf(bucket_label, sizeof(bucket_label), last ? ">=%u" : "<%u", HTTP_METRICS_BUCKET_LIMITS_MS[last ? i - 1 : i]);
+            out.printf("  %5s", bucket_label);
+        }
+        out.printf("  (last %u samples)\n", endpoint.samples);
+
+        for (int phase = 0; phase < HTTP_PHASE_COUNT; phase++)
+        {
+            if (endpoint.p50_ms[phase] == HTTP_PHASE_NOT_MEASURED)
+            {
+                continue;
+            }
+            out.printf("  %-15s %5u %5u", http_phase_str((http_phase)phase), endpoint.p50_ms[phase], endpoint.p90_ms[phase]);
+            for (int i = 0; i < HTTP_METRICS_BUCKETS; i++)
+            {
+                out.printf("  %5u", endpoint.histogram[phase][i]);
+            }
+            out.println();
+        }
+    }
+}
+
+const char *http_phase_str(http_phase phase)
+{
+    switch (phase)
+    {
+    case HTTP_PHASE_DNS:
+        return "dns";
+    case HTTP_PHASE_TCP:
+        return "tcp";
+    case HTTP_PHASE_TLS:
+        return "tls";
+    case HTTP_PHASE_TTFB:
+        return "ttfb";
+    case HTTP_PHASE_BODY:
+        return "body";
+    case HTTP_PHASE_PARSE:
+        return "parse";
+    case HTTP_PHASE_COUNT:
+        break;
+    }
+    return "unknown";
+}
+
+const char *http_error_kind_str(http_error_kind kind)
+{
+    switch (kind)
+    {
+    case HTTP_ERROR_NONE:
+        return "none";
+    case HTTP_ERROR_DNS:
+        return "dns";
+    case HTTP_ERROR_CONNECT:
+        return "connect";
+    case HTTP_ERROR_STATUS:
+        return "status";
+    case HTTP_ERROR_BODY:
+        return "body";
+    case HTTP_ERROR_PARSE:
+        return "parse";
+    case HTTP_ERROR_COUNT:
+        break;
+    }
+    return "unknown";
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <Arduino.h>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+enum http_phase
+{
+    HTTP_PHASE_DNS,
+    HTTP_PHASE_TCP,   // plain http only, the https client connects and handshakes in one call
+    HTTP_PHASE_TLS,   // https only, includes the tcp connect
+    HTTP_PHASE_TTFB,  // request sent until the response headers are parsed
+    HTTP_PHASE_BODY,  // waiting on the socket while the body is read
+    HTTP_PHASE_PARSE, // inflating and deserializing, our own cpu time
+    HTTP_PHASE_COUNT,
+};
+
+enum http_error_kind
+{
+    HTTP_ERROR_NONE,
+    HTTP_ERROR_DNS,
+    HTTP_ERROR_CONNECT,
+    HTTP_ERROR_STATUS, // transport error or status >= 400 from sendRequest
+    HTTP_ERROR_BODY,   // truncated, corrupt, cancelled or timed out while reading
+    HTTP_ERROR_PARSE,
+    HTTP_ERROR_COUNT,
+};
+
+const uint16_t HTTP_PHASE_NOT_MEASURED = UINT16_MAX;
+const int HTTP_METRICS_SAMPLES = 32; // ring buffer size per endpoint
+const int HTTP_METRICS_BUCKETS = 8;
+// Upper bounds of the histogram buckets in ms, the last bucket takes everything above
+extern const uint16_t HTTP_METRICS_BUCKET_LIMITS_MS[HTTP_METRICS_BUCKETS - 1];
+
+struct http_request_sample
+{
+    uint16_t phase_ms[HTTP_PHASE_COUNT];
+    int16_t http_code;
+    int8_t rssi;
+    http_error_kind error;
+    uint32_t json_bytes; // arena high water mark while the response was decoded
+};
+
+struct http_endpoint_metrics
+{
+    std::string host;
+    std::string name; // method and last path segment, e.g. "GET /time-entries"
+    // counters since boot or the last reset
+    uint32_t requests;
+    uint32_t errors[HTTP_ERROR_COUNT];
+    uint32_t json_high_water;
+    // computed over the samples still in the ring buffer
+    uint16_t samples;
+    uint16_t p50_ms[HTTP_PHASE_COUNT];
+    uint16_t p90_ms[HTTP_PHASE_COUNT];
+    uint16_t histogram[HTTP_PHASE_COUNT][HTTP_METRICS_BUCKETS];
+    int8_t average_rssi;
+    int16_t last_http_code;
+};
+
+std::string http_metrics_endpoint_name(const std::string &method, const std::string &url);
+http_request_sample http_metrics_new_sample(void);
+void http_metrics_record(const std::string &host, const std::string &name, const http_request_sample &sample);
+std::vector<http_endpoint_metrics> http_metrics_snapshot(void);
+void http_metrics_reset(void);
+void http_metrics_print(Print &out);
+const char *http_phase_str(http_phase phase);
+const char *http_error_kind_str(http_error_kind kind);
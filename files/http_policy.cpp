@@ -0,0 +1,254 @@
+#include <Arduino.h>
+#include <esp_random.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "http_policy.h"
+#include "config.h"
+
+struct http_host_limits
+{
+    const char *host;
+    float capacity;
+    float refill_per_sec;
+};
+
+// Hosts without an entry fall back to the last (default) limits
+const http_host_limits HTTP_HOST_LIMITS[] = {
+    {"api.clockify.me", 10.0f, 1.0f},                            // well below the 50 req/s api limit
+    {"financialmodelingprep.com", 5.0f, 250.0f / (24 * 60 * 60)}, // free tier: 250 requests a day
+    {"", 10.0f, 1.0f},
+};
+
+const int MAX_HTTP_POLICY_HOSTS = 8;
+
+static http_host_policy_state http_policy_hosts[MAX_HTTP_POLICY_HOSTS];
+static int http_policy_hosts_count = 0;
+static SemaphoreHandle_t http_policy_mutex = xSemaphoreCreateMutex();
+
+std::string http_policy_host_from_url(const std::string &url)
+{
+    size_t start = url.find("://");
+    start = (start == std::string::npos) ? 0 : start + 3;
+    size_t end = url.find_first_of(":/?", start);
+    return url.substr(start, end == std::string::npos ? std::string::npos : end - start);
+}
+
+static const http_host_limits *find_host_limits(const std::string &host)
+{
+    const int count = sizeof(HTTP_HOST_LIMITS) / sizeof(HTTP_HOST_LIMITS[0]);
+    for (int i = 0; i < count - 1; i++)
+    {
+        if (host == HTTP_HOST_LIMITS[i].host)
+        {
+            return &HTTP_HOST_LIMITS[i];
+        }
+    }
+    return &HTTP_HOST_LIMITS[count - 1];
+}
+
+// Must be called with http_policy_mutex held
+static http_host_policy_state *get_host_state(const std::string &host)
+{
+    for (int i = 0; i < http_policy_hosts_count; i++)
+    {
+        if (http_policy_hosts[i].host == host)
+        {
+            return &http_policy_hosts[i];
+        }
+    }
+
+    // Table full -> reuse the last slot, the policy degrades gracefully instead of growing
+    int index = (http_policy_hosts_count < MAX_HTTP_POLICY_HOSTS) ? http_policy_hosts_count++ : MAX_HTTP_POLICY_HOSTS - 1;
+    const http_host_limits *limits = find_host_limits(host);
+    http_policy_hosts[index] = {
+        .host = host,
+        .tokens = limits->capacity,
+        .capacity = limits->capacity,
+        .refill_per_sec = limits->refill_per_sec,
+        .last_refill_ms = millis(),
+        .consecutive_failures = 0,
+        .backoff_until_ms = 0,
+        .circuit = HTTP_CIRCUIT_CLOSED,
+        .circuit_opened_ms = 0,
+        .probe_in_flight = false,
+        .requests = 0,
+        .failures = 0,
+        .rate_limited = 0,
+        .short_circuited = 0,
+        .last_http_code = 0,
+    };
+    return &http_policy_hosts[index];
+}
+
+static void refill_tokens(http_host_policy_state *state, uint32_t now)
+{
+    uint32_t elapsed_ms = now - state->last_refill_ms;
+    state->last_refill_ms = now;
+    state->tokens += state->refill_per_sec * elapsed_ms / 1000.0f;
+    if (state->tokens > state->capacity)
+    {
+        state->tokens = state->capacity;
+    }
+}
+
+static uint32_t backoff_delay_ms(uint32_t consecutive_failures)
+{
+    if (consecutive_failures == 0)
+    {
+        return 0;
+    }
+    uint32_t shift = consecutive_failures - 1 > 16 ? 16 : consecutive_failures - 1;
+    uint64_t delay = (uint64_t)HTTP_BACKOFF_BASE_MS << shift;
+    if (delay > HTTP_BACKOFF_MAX_MS)
+    {
+        delay = HTTP_BACKOFF_MAX_MS;
+    }
+    // Equal jitter: half fixed, half random, so retries from several tasks do not line up
+    uint32_t half = (uint32_t)delay / 2;
+    return half + (half > 0 ? esp_random() % (half + 1) : 0);
+}
+
+http_policy_decision http_policy_acquire(const std::string &host)
+{
+    xSemaphoreTake(http_policy_mutex, portMAX_DELAY);
+    http_host_policy_state *state = get_host_state(host);
+    uint32_t now = millis();
+    http_policy_decision decision = HTTP_POLICY_ALLOW;
+
+    if (state->circuit == HTTP_CIRCUIT_OPEN && now - state->circuit_opened_ms >= HTTP_CIRCUIT_OPEN_MS)
+    {
+        state->circuit = HTTP_CIRCUIT_HALF_OPEN;
+        state->probe_in_flight = false;
+    }
+
+    refill_tokens(state, now);
+
+    if (state->circuit == HTTP_CIRCUIT_OPEN || (state->circuit == HTTP_CIRCUIT_HALF_OPEN && state->probe_in_flight))
+    {
+        decision = HTTP_POLICY_CIRCUIT_OPEN;
+        state->short_circuited++;
+    }
+    else if ((int32_t)(state->backoff_until_ms - now) > 0)
+    {
+        decision = HTTP_POLICY_BACKING_OFF;
+        state->short_circuited++;
+    }
+    else if (state->tokens < 1.0f)
+    {
+        decision = HTTP_POLICY_RATE_LIMITED;
+        state->rate_limited++;
+    }
+    else
+    {
+        state->tokens -= 1.0f;
+        state->requests++;
+        if (state->circuit == HTTP_CIRCUIT_HALF_OPEN)
+        {
+            state->probe_in_flight = true;
+        }
+    }
+
+    xSemaphoreGive(http_policy_mutex);
+    return decision;
+}
+
+bool http_policy_is_rate_limited(const std::string &host)
+{
+    xSemaphoreTake(http_policy_mutex, portMAX_DELAY);
+    http_host_policy_state *state = get_host_state(host);
+    refill_tokens(state, millis());
+    bool is_rate_limited = state->tokens < 1.0f;
+    xSemaphoreGive(http_policy_mutex);
+    return is_rate_limited;
+}
+
+bool http_policy_is_retryable(int http_code)
+{
+    // Connection level errors, throttling and server errors say something about the host,
+    // other 4xx codes are problems with the request itself
+    return http_code <= 0 || http_code == 429 || http_code >= 500;
+}
+
+void http_policy_report(const std::string &host, int http_code)
+{
+    xSemaphoreTake(http_policy_mutex, portMAX_DELAY);
+    http_host_policy_state *state = get_host_state(host);
+    uint32_t now = millis();
+    state->last_http_code = http_code;
+    state->probe_in_flight = false;
+
+    if (!http_policy_is_retryable(http_code))
+    {
+        state->consecutive_failures = 0;
+        state->backoff_until_ms = now;
+        state->circuit = HTTP_CIRCUIT_CLOSED;
+    }
+    else
+    {
+        state->failures++;
+        state->consecutive_failures++;
+        state->backoff_until_ms = now + backoff_delay_ms(state->consecutive_failures);
+        if (state->circuit == HTTP_CIRCUIT_HALF_OPEN || state->consecutive_failures >= HTTP_CIRCUIT_FAILURE_THRESHOLD)
+        {
+            if (state->circuit != HTTP_CIRCUIT_OPEN)
+            {
+                Serial.printf("Circuit open for %s after %u failures\n", host.c_str(), state->consecutive_failures);
+            }
+            state->circuit = HTTP_CIRCUIT_OPEN;
+            state->circuit_opened_ms = now;
+        }
+    }
+    xSemaphoreGive(http_policy_mutex);
+}
+
+uint32_t http_policy_retry_delay_ms(const std::string &host)
+{
+    xSemaphoreTake(http_policy_mutex, portMAX_DELAY);
+    http_host_policy_state *state = get_host_state(host);
+    int32_t remaining = (int32_t)(state->backoff_until_ms - millis());
+    xSemaphoreGive(http_policy_mutex);
+    return remaining > 0 ? (uint32_t)remaining : 0;
+}
+
+const char *http_policy_decision_str(http_policy_decision decision)
+{
+    switch (decision)
+    {
+    case HTTP_POLICY_ALLOW:
+        return "allow";
+    case HTTP_POLICY_RATE_LIMITED:
+        return "rate limited";
+    case HTTP_POLICY_BACKING_OFF:
+        return "backing off";
+    case HTTP_POLICY_CIRCUIT_OPEN:
+        return "circuit open";
+    }
+    return "unknown";
+}
+
+const char *http_circuit_state_str(http_circuit_state state)
+{
+    switch (state)
+    {
+    case HTTP_CIRCUIT_CLOSED:
+        return "closed";
+    case HTTP_CIRCUIT_OPEN:
+        return "open";
+    case HTTP_CIRCUIT_HALF_OPEN:
+        return "half-open";
+    }
+    return "unknown";
+}
+
+std::vector<http_host_policy_state> http_policy_snapshot(void)
+{
+    xSemaphoreTake(http_policy_mutex, portMAX_DELAY);
+    uint32_t now = millis();
+    for (int i = 0; i < http_policy_hosts_count; i++)
+    {
+        refill_tokens(&http_policy_hosts[i], now);
+    }
+    std::vector<http_host_policy_state> snapshot(http_policy_hosts, http_policy_hosts + http_policy_hosts_count);
+    xSemaphoreGive(http_policy_mutex);
+    return snapshot;
+}
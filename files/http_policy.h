@@ -0,0 +1,54 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+enum http_circuit_state
+{
+    HTTP_CIRCUIT_CLOSED,    // requests flow normally
+    HTTP_CIRCUIT_OPEN,      // host considered down, requests fail fast
+    HTTP_CIRCUIT_HALF_OPEN, // cooldown over, a single probe request is allowed
+};
+
+struct http_host_policy_state
+{
+    std::string host;
+    // token bucket
+    float tokens;
+    float capacity;
+    float refill_per_sec;
+    uint32_t last_refill_ms;
+    // backoff
+    uint32_t consecutive_failures;
+    uint32_t backoff_until_ms;
+    // circuit breaker
+    http_circuit_state circuit;
+    uint32_t circuit_opened_ms;
+    bool probe_in_flight;
+    // counters
+    uint32_t requests;
+    uint32_t failures;
+    uint32_t rate_limited;
+    uint32_t short_circuited;
+    int last_http_code;
+};
+
+enum http_policy_decision
+{
+    HTTP_POLICY_ALLOW,
+    HTTP_POLICY_RATE_LIMITED,
+    HTTP_POLICY_BACKING_OFF,
+    HTTP_POLICY_CIRCUIT_OPEN,
+};
+
+std::string http_policy_host_from_url(const std::string &url);
+http_policy_decision http_policy_acquire(const std::string &host);
+void http_policy_report(const std::string &host, int http_code);
+uint32_t http_policy_retry_delay_ms(const std::string &host);
+bool http_policy_is_retryable(int http_code);
+// True while the token bucket of host is empty, a request now would be skipped. Takes no token
+bool http_policy_is_rate_limited(const std::string &host);
+const char *http_policy_decision_str(http_policy_decision decision);
+const char *http_circuit_state_str(http_circuit_state state);
+std::vector<http_host_policy_state> http_policy_snapshot(void);
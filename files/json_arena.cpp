@@ -0,0 +1,183 @@
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "json_arena.h"
+#include "config.h"
+
+// Every allocation is prefixed with its size, 8 bytes keep doubles and 64 bit integers aligned
+const size_t JSON_ARENA_HEADER_SIZE = 8;
+const size_t JSON_ARENA_ALIGNMENT = 8;
+
+static json_arena json_arenas[JSON_ARENA_COUNT];
+static json_arena json_arena_heap; // lent out when every arena is busy, it has no block and spills everything
+static json_arena_stats arena_stats = {};
+static SemaphoreHandle_t json_arena_mutex = xSemaphoreCreateMutex();
+
+static size_t align_size(size_t size)
+{
+    return (size + JSON_ARENA_ALIGNMENT - 1) & ~(JSON_ARENA_ALIGNMENT - 1);
+}
+
+static size_t *block_header(void *pointer)
+{
+    return (size_t *)((uint8_t *)pointer - JSON_ARENA_HEADER_SIZE);
+}
+
+bool json_arena::owns(const void *pointer) const
+{
+    return pointer >= base && pointer < base + capacity;
+}
+
+// Must be called with json_arena_mutex held
+void json_arena::rewind_if_unused(void)
+{
+    if (allocations == 0 && !reserved && offset > 0)
+    {
+        offset = 0;
+        arena_stats.resets++;
+    }
+}
+
+void *json_arena::allocate(size_t size)
+{
+    size_t total = JSON_ARENA_HEADER_SIZE + align_size(size);
+    xSemaphoreTake(json_arena_mutex, portMAX_DELAY);
+    uint8_t *block;
+    if (offset + total <= capacity)
+    {
+        block = base + offset;
+        offset += total;
+    }
+    else
+    {
+        block = (uint8_t *)heap_caps_malloc(total, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (block == nullptr)
+        {
+            block = (uint8_t *)malloc(total);
+        }
+        if (block == nullptr)
+        {
+            xSemaphoreGive(json_arena_mutex);
+            return nullptr;
+        }
+        arena_stats.spills++;
+    }
+    *(size_t *)block = size;
+    allocations++;
+    live_bytes += size;
+    peak_bytes = max(peak_bytes, live_bytes);
+    xSemaphoreGive(json_arena_mutex);
+    return block + JSON_ARENA_HEADER_SIZE;
+}
+
+void json_arena::deallocate(void *pointer)
+{
+    if (pointer == nullptr)
+    {
+        return;
+    }
+    size_t *header = block_header(pointer);
+    xSemaphoreTake(json_arena_mutex, portMAX_DELAY);
+    allocations--;
+    live_bytes -= *header;
+    if (!owns(header))
+    {
+        heap_caps_free(header);
+    }
+    rewind_if_unused();
+    xSemaphoreGive(json_arena_mutex);
+}
+
+void *json_arena::reallocate(void *pointer, size_t new_size)
+{
+    if (pointer == nullptr)
+    {
+        return allocate(new_size);
+    }
+
+    size_t *header = block_header(pointer);
+    xSemaphoreTake(json_arena_mutex, portMAX_DELAY);
+    size_t old_size = *header;
+    // ArduinoJson grows the string it is reading and shrinks its pools at the end, both on the latest block
+    size_t block_start = (uint8_t *)header - base;
+    bool is_last_block = owns(header) && block_start + JSON_ARENA_HEADER_SIZE + align_size(old_size) == offset;
+    if (is_last_block && block_start + JSON_ARENA_HEADER_SIZE + align_size(new_size) <= capacity)
+    {
+        offset = block_start + JSON_ARENA_HEADER_SIZE + align_size(new_size);
+        *header = new_size;
+        live_bytes = live_bytes - old_size + new_size;
+        peak_bytes = max(peak_bytes, live_bytes);
+        xSemaphoreGive(json_arena_mutex);
+        return pointer;
+    }
+    xSemaphoreGive(json_arena_mutex);
+
+    void *moved = allocate(new_size);
+    if (moved == nullptr)
+    {
+        return nullptr;
+    }
+    memcpy(moved, pointer, min(old_size, new_size));
+    deallocate(pointer);
+    return moved;
+}
+
+void json_arena_begin(void)
+{
+    xSemaphoreTake(json_arena_mutex, portMAX_DELAY);
+    arena_stats.arenas = 0;
+    for (json_arena &arena : json_arenas)
+    {
+        // Only PSRAM will do, an arena carved out of internal RAM would cost more than it saves
+        arena.base = (uint8_t *)heap_caps_malloc(JSON_ARENA_SIZE, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        arena.capacity = arena.base != nullptr ? JSON_ARENA_SIZE : 0;
+        arena_stats.arenas += arena.base != nullptr ? 1 : 0;
+    }
+    arena_stats.arena_size = JSON_ARENA_SIZE;
+    xSemaphoreGive(json_arena_mutex);
+    Serial.printf("JSON arenas: %u of %u KB in PSRAM\n", arena_stats.arenas, JSON_ARENA_SIZE / 1024);
+}
+
+json_arena *json_arena_acquire(void)
+{
+    xSemaphoreTake(json_arena_mutex, portMAX_DELAY);
+    for (json_arena &arena : json_arenas)
+    {
+        if (arena.capacity > 0 && !arena.reserved && arena.allocations == 0)
+        {
+            arena.reserved = true;
+            arena.peak_bytes = 0;
+            xSemaphoreGive(json_arena_mutex);
+            return &arena;
+        }
+    }
+    arena_stats.exhausted++;
+    xSemaphoreGive(json_arena_mutex);
+    return &json_arena_heap;
+}
+
+void json_arena_release(json_arena *arena)
+{
+    xSemaphoreTake(json_arena_mutex, portMAX_DELAY);
+    if (arena != &json_arena_heap)
+    {
+        arena_stats.peak_bytes = max(arena_stats.peak_bytes, (uint32_t)arena->peak_bytes);
+        arena->reserved = false;
+        arena->rewind_if_unused();
+    }
+    xSemaphoreGive(json_arena_mutex);
+}
+
+json_arena_stats json_arena_get_stats(void)
+{
+    xSemaphoreTake(json_arena_mutex, portMAX_DELAY);
+    json_arena_stats stats = arena_stats;
+    stats.in_use = 0;
+    for (const json_arena &arena : json_arenas)
+    {
+        stats.in_use += (arena.reserved || arena.allocations > 0) ? 1 : 0;
+    }
+    xSemaphoreGive(json_arena_mutex);
+    return stats;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <ArduinoJson.h>
+#include <cstddef>
+#include <cstdint>
+
+struct json_arena_stats
+{
+    uint32_t arenas;
+    uint32_t arena_size;
+    uint32_t in_use;
+    uint32_t peak_bytes; // largest high water mark of any request since boot
+    uint32_t resets;
+    uint32_t spills;    // allocations that did not fit their arena and went to the heap
+    uint32_t exhausted; // requests that found every arena busy and used the heap only
+};
+
+// Bump allocator over a PSRAM block for the JsonDocument of one response. Freeing is free, the block is
+// rewound in O(1) once the document's last allocation is released and the request is done with the arena.
+// What does not fit spills to the PSRAM heap, so a large response still decodes. Keeping parser churn out of
+// internal RAM leaves it unfragmented for LVGL and the WiFi stack.
+class json_arena : public ArduinoJson::Allocator
+{
+public:
+    void *allocate(size_t size) override;
+    void deallocate(void *pointer) override;
+    void *reallocate(void *pointer, size_t new_size) override;
+
+    // Peak bytes held since the arena was last acquired, spills included
+    size_t high_water(void) const { return peak_bytes; }
+
+private:
+    friend void json_arena_begin(void);
+    friend json_arena *json_arena_acquire(void);
+    friend void json_arena_release(json_arena *arena);
+    friend json_arena_stats json_arena_get_stats(void);
+
+    bool owns(const void *pointer) const;
+    void rewind_if_unused(void);
+
+    uint8_t *base = nullptr;
+    size_t capacity = 0;
+    size_t offset = 0;        // next free byte in the block
+    size_t live_bytes = 0;    // held by live allocations, spills included
+    size_t peak_bytes = 0;
+    uint32_t allocations = 0; // live allocations, the block rewinds when this drops to 0
+    bool reserved = false;    // a request is decoding into the arena
+};
+
+// Creates the arenas, PSRAM permitting. Without them every request falls back to the heap.
+void json_arena_begin(void);
+// Lends an arena to one request, never nullptr: when all are busy a heap backed one is returned
+json_arena *json_arena_acquire(void);
+// Called once the response is decoded, the arena rewinds as soon as the document is destroyed
+void json_arena_release(json_arena *arena);
+json_arena_stats json_arena_get_stats(void);
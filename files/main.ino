@@ -3,8 +3,12 @@
 #include "stock_widget.h"
 #include "clockify_widget.h"
 #include "linkedin_widget.h"
-#include <WiFi.h>
-#include "time.h"
+#include "diagnostics_widget.h"
+#include "connectivity.h"
+#include "clock_sync.h"
+#include "radio_power.h"
+#include "serial_commands.h"
+#include "json_arena.h"
 #include "config.h"
 
 LilyGo_Class amoled;
@@ -19,6 +23,7 @@ lv_obj_t *tileview = nullptr;
 lv_obj_t *tile_stock = nullptr;
 lv_obj_t *tile_clockify = nullptr;
 lv_obj_t *tile_linkedin = nullptr;
+lv_obj_t *tile_diagnostics = nullptr;
 
 void setup()
 {
@@ -41,23 +46,9 @@ void setup()
         }
     }
 
-    WiFi.begin(ssid, password);
-    Serial.println("Connecting");
-    while (WiFi.status() != WL_CONNECTED)
-    {
-        delay(500);
-        Serial.print(".");
-    }
-    Serial.println("");
-    Serial.print("Connected to WiFi network with IP Address: ");
-    Serial.println(WiFi.localIP());
-    configTime(gmtOffset_sec, daylightOffset_sec, ntpServer);
-    struct tm timeinfo;
-    while (!getLocalTime(&timeinfo, 5000))
-    {
-        Serial.println("Failed to obtain time");
-    }
-    Serial.println(&timeinfo, "Current UTC time: %A, %B %d %Y %H:%M:%S");
+    // Timers and date math work right away when the RTC has a valid time, SNTP corrects it later
+    clock_sync_begin(&amoled);
+
     beginLvglHelper(amoled);
 
     tileview = lv_tileview_create(lv_screen_active());
@@ -73,8 +64,20 @@ void setup()
     lv_obj_set_style_pad_all(tile_stock, 10, LV_PART_MAIN);
     render_stock_widget(tile_stock);
 
-    tile_clockify = lv_tileview_add_tile(tileview, 2, 0, LV_DIR_LEFT);
+    tile_clockify = lv_tileview_add_tile(tileview, 2, 0, (lv_dir_t)(LV_DIR_RIGHT | LV_DIR_LEFT));
     lv_obj_set_style_pad_all(tile_clockify, 10, LV_PART_MAIN);
+
+    tile_diagnostics = lv_tileview_add_tile(tileview, 3, 0, LV_DIR_LEFT);
+    lv_obj_set_style_pad_all(tile_diagnostics, 10, LV_PART_MAIN);
+    render_diagnostics_widget(tile_diagnostics);
+
+    // Before any request, while PSRAM is still in one piece
+    json_arena_begin();
+
+    // The ui is up, the network comes up in the background
+    start_stock_widget_tasks();
+    radio_power_begin(RADIO_POWER_PROFILE);
+    connectivity_begin(ssid, password, ntpServer, gmtOffset_sec, daylightOffset_sec);
 }
 
 void loop()
@@ -89,6 +92,12 @@ void loop()
         stop_clockify_widget_tasks();
     }
 
+    if (tileview != nullptr && lv_tileview_get_tile_active(tileview) == tile_diagnostics)
+    {
+        update_diagnostics_widget();
+    }
+
+    serial_commands_poll();
     lv_task_handler();
     delay(5);
 }
@@ -0,0 +1,165 @@
+#include <Arduino.h>
+#include "market_calendar.h"
+#include "utils.h"
+
+const int MARKET_OPEN_MINUTE = 9 * 60 + 30; // new york time
+const int MARKET_CLOSE_MINUTE = 16 * 60;
+const int MARKET_EARLY_CLOSE_MINUTE = 13 * 60;
+const int MARKET_SEARCH_DAYS = 10; // longer than any run of weekend and holiday days
+
+static int32_t day_of(int year, int month, int day)
+{
+    return utc_datetime_to_time(year, month, day, 0, 0, 0) / (24 * 60 * 60);
+}
+
+int epoch_day_weekday(int32_t epoch_day)
+{
+    // 1970-01-01 was a Thursday
+    return (epoch_day + 4) % 7;
+}
+
+static int32_t nth_weekday(int year, int month, int weekday, int n)
+{
+    int32_t first = day_of(year, month, 1);
+    return first + (weekday - epoch_day_weekday(first) + 7) % 7 + 7 * (n - 1);
+}
+
+static int32_t last_weekday(int year, int month, int weekday)
+{
+    int32_t last = day_of(year, month + 1, 1) - 1;
+    return last - (epoch_day_weekday(last) - weekday + 7) % 7;
+}
+
+// Anonymous Gregorian algorithm
+static int32_t easter_sunday(int year)
+{
+    int a = year % 19;
+    int b = year / 100;
+    int c = year % 100;
+    int d = b / 4;
+    int e = b % 4;
+    int f = (b + 8) / 25;
+    int g = (b - f + 1) / 3;
+    int h = (19 * a + b - d - g + 15) % 30;
+    int i = c / 4;
+    int k = c % 4;
+    int l = (32 + 2 * e + 2 * i - h - k) % 7;
+    int m = (a + 11 * h + 22 * l) / 451;
+    int month = (h + l - 7 * m + 114) / 31;
+    int day = (h + l - 7 * m + 114) % 31 + 1;
+    return day_of(year, month, day);
+}
+
+// Saturday holidays are taken on the Friday before, Sunday ones on the Monday after
+static int32_t observed(int32_t day)
+{
+    int weekday = epoch_day_weekday(day);
+    return weekday == 6 ? day - 1 : weekday == 0 ? day + 1 : day;
+}
+
+static int32_t thanksgiving(int year)
+{
+    return nth_weekday(year, 11, 4, 4);
+}
+
+static bool is_holiday(int32_t day, int year)
+{
+    int32_t new_year = day_of(year, 1, 1);
+    const int32_t holidays[] = {
+        // A Saturday New Year's Day is not taken on the Friday before, which still closes the old year
+        epoch_day_weekday(new_year) == 6 ? -1 : observed(new_year),
+        nth_weekday(year, 1, 1, 3),
+        nth_weekday(year, 2, 1, 3),
+        easter_sunday(year) - 2,
+        last_weekday(year, 5, 1),
+        year >= 2022 ? observed(day_of(year, 6, 19)) : -1,
+        observed(day_of(year, 7, 4)),
+        nth_weekday(year, 9, 1, 1),
+        thanksgiving(year),
+        observed(day_of(year, 12, 25)),
+    };
+    for (int32_t holiday : holidays)
+    {
+        if (holiday == day)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// The day after Thanksgiving, July 3rd and December 24th. The latter two only from Monday to Thursday, on
+// a Friday they are the observed holiday
+static bool is_early_close(int32_t day, const struct tm &date)
+{
+    int weekday = epoch_day_weekday(day);
+    bool is_eve = (date.tm_mon == 6 && date.tm_mday == 3) || (date.tm_mon == 11 && date.tm_mday == 24);
+    return day == thanksgiving(date.tm_year + 1900) + 1 || (is_eve && weekday >= 1 && weekday <= 4);
+}
+
+// New York is on daylight saving time from 2:00 on the second Sunday of March to 2:00 on the first Sunday
+// of November. Sessions are far from 2:00, so the day decides
+static int new_york_utc_offset_minutes(int32_t day, int year)
+{
+    bool is_daylight_saving = day >= nth_weekday(year, 3, 0, 2) && day < nth_weekday(year, 11, 0, 1);
+    return is_daylight_saving ? -4 * 60 : -5 * 60;
+}
+
+bool market_session_on(uint16_t epoch_day, market_session *session)
+{
+    int32_t day = epoch_day;
+    int weekday = epoch_day_weekday(day);
+    if (weekday == 0 || weekday == 6)
+    {
+        return false;
+    }
+    time_t midnight = (time_t)day * 24 * 60 * 60;
+    struct tm date;
+    gmtime_r(&midnight, &date);
+    int year = date.tm_year + 1900;
+    if (is_holiday(day, year))
+    {
+        return false;
+    }
+
+    // Sessions of a new york day are within the same utc day
+    int offset_minutes = new_york_utc_offset_minutes(day, year);
+    int close_minute = is_early_close(day, date) ? MARKET_EARLY_CLOSE_MINUTE : MARKET_CLOSE_MINUTE;
+    session->open = midnight + (MARKET_OPEN_MINUTE - offset_minutes) * 60;
+    session->close = midnight + (close_minute - offset_minutes) * 60;
+    return true;
+}
+
+bool market_is_open(time_t time)
+{
+    market_session session;
+    return market_session_on(time / (24 * 60 * 60), &session) && time >= session.open && time < session.close;
+}
+
+time_t market_next_open(time_t time)
+{
+    int32_t today = time / (24 * 60 * 60);
+    market_session session;
+    for (int32_t day = today; day <= today + MARKET_SEARCH_DAYS; day++)
+    {
+        if (market_session_on(day, &session) && session.open > time)
+        {
+            return session.open;
+        }
+    }
+    return time + (time_t)MARKET_SEARCH_DAYS * 24 * 60 * 60;
+}
+
+time_t market_last_close(time_t time)
+{
+    int32_t today = time / (24 * 60 * 60);
+    market_session session;
+    for (int32_t day = today; day >= max(today - MARKET_SEARCH_DAYS, (int32_t)0); day--)
+    {
+        if (market_session_on(day, &session) && session.close <= time)
+        {
+            return session.close;
+        }
+    }
+    return 0;
+}
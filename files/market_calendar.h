@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+
+// Regular session of NYSE and NASDAQ, 9:30 to 16:00 New York time, 13:00 on the early close days
+struct market_session
+{
+    time_t open; // utc
+    time_t close;
+};
+
+// 0 is Sunday, 6 is Saturday
+int epoch_day_weekday(int32_t epoch_day);
+// False on weekends and exchange holidays. The holidays follow the NYSE rules: New Year's Day, Martin
+// Luther King Jr. Day, Washington's Birthday, Good Friday, Memorial Day, Juneteenth (from 2022),
+// Independence Day, Labor Day, Thanksgiving and Christmas, moved to the Friday before or the Monday after
+// when they fall on a weekend. Unscheduled closures are not known
+bool market_session_on(uint16_t epoch_day, market_session *session);
+bool market_is_open(time_t time);
+// The first session open after time
+time_t market_next_open(time_t time);
+// The last session close at or before time, 0 before 1970-01-15
+time_t market_last_close(time_t time);
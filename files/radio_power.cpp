@@ -0,0 +1,217 @@
+#include <Arduino.h>
+#include <WiFi.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "radio_power.h"
+
+const uint32_t RADIO_WAKE_LEAD_MS = 500; // wake before a job so the AP has delivered buffered frames
+const uint32_t RADIO_IDLE_AFTER_REQUEST_MS = 200;
+const uint32_t RADIO_POWER_HOUR_MS = 60 * 60 * 1000;
+const uint32_t RADIO_SAVER_POLL_MULTIPLIER = 4;
+const int MAX_RADIO_WAKE_JOBS = 4;
+
+struct radio_wake_job
+{
+    const char *job;
+    uint32_t due_ms;
+};
+
+static SemaphoreHandle_t radio_power_mutex = xSemaphoreCreateMutex();
+static radio_power_profile current_radio_power_profile = RADIO_POWER_BALANCED;
+static radio_wake_job radio_wake_jobs[MAX_RADIO_WAKE_JOBS] = {};
+static int active_radio_requests = 0;
+static uint32_t last_request_end_ms = 0;
+static bool radio_awake = true;
+static uint32_t radio_awake_since_ms = 0;
+static uint32_t radio_awake_ms_this_hour = 0;
+static uint32_t radio_awake_ms_last_hour = 0;
+static uint32_t radio_power_hour_started_ms = 0;
+static uint32_t radio_wakeups = 0;
+
+// Must be called with radio_power_mutex held
+static void account_radio_time(uint32_t now)
+{
+    if (radio_awake)
+    {
+        radio_awake_ms_this_hour += now - radio_awake_since_ms;
+        radio_awake_since_ms = now;
+    }
+    if (now - radio_power_hour_started_ms >= RADIO_POWER_HOUR_MS)
+    {
+        radio_awake_ms_last_hour = radio_awake_ms_this_hour;
+        radio_awake_ms_this_hour = 0;
+        Serial.printf("Radio was awake %u s in the last hour\n", radio_awake_ms_last_hour / 1000);
+        radio_power_hour_started_ms = now;
+    }
+}
+
+// Must be called with radio_power_mutex held
+static bool is_radio_needed(uint32_t now)
+{
+    if (current_radio_power_profile == RADIO_POWER_PERFORMANCE || active_radio_requests > 0)
+    {
+        return true;
+    }
+    if (now - last_request_end_ms < RADIO_IDLE_AFTER_REQUEST_MS)
+    {
+        return true;
+    }
+    for (int i = 0; i < MAX_RADIO_WAKE_JOBS; i++)
+    {
+        if (radio_wake_jobs[i].job != nullptr && (int32_t)(radio_wake_jobs[i].due_ms - now) <= (int32_t)RADIO_WAKE_LEAD_MS)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Must be called with radio_power_mutex held
+static void apply_radio_power(void)
+{
+    uint32_t now = millis();
+    account_radio_time(now);
+
+    bool needed = is_radio_needed(now);
+    if (needed == radio_awake)
+    {
+        return;
+    }
+    WiFi.setSleep(needed ? WIFI_PS_NONE : WIFI_PS_MAX_MODEM);
+    radio_awake = needed;
+    radio_awake_since_ms = now;
+    if (needed)
+    {
+        radio_wakeups++;
+    }
+}
+
+void radio_power_begin(radio_power_profile profile)
+{
+    xSemaphoreTake(radio_power_mutex, portMAX_DELAY);
+    current_radio_power_profile = profile;
+    radio_power_hour_started_ms = millis();
+    radio_awake_since_ms = radio_power_hour_started_ms;
+    WiFi.setSleep(WIFI_PS_NONE);
+    radio_awake = true;
+    apply_radio_power();
+    xSemaphoreGive(radio_power_mutex);
+}
+
+void radio_power_set_profile(radio_power_profile profile)
+{
+    xSemaphoreTake(radio_power_mutex, portMAX_DELAY);
+    current_radio_power_profile = profile;
+    apply_radio_power();
+    xSemaphoreGive(radio_power_mutex);
+}
+
+void radio_power_acquire(void)
+{
+    xSemaphoreTake(radio_power_mutex, portMAX_DELAY);
+    active_radio_requests++;
+    apply_radio_power();
+    xSemaphoreGive(radio_power_mutex);
+}
+
+void radio_power_release(void)
+{
+    xSemaphoreTake(radio_power_mutex, portMAX_DELAY);
+    if (active_radio_requests > 0)
+    {
+        active_radio_requests--;
+    }
+    last_request_end_ms = millis();
+    xSemaphoreGive(radio_power_mutex);
+    // The radio goes back to sleep from radio_power_update after the idle period
+}
+
+void radio_power_schedule_wake(const char *job, uint32_t due_ms)
+{
+    xSemaphoreTake(radio_power_mutex, portMAX_DELAY);
+    int free_slot = -1;
+    for (int i = 0; i < MAX_RADIO_WAKE_JOBS; i++)
+    {
+        if (radio_wake_jobs[i].job == job)
+        {
+            free_slot = i;
+            break;
+        }
+        if (radio_wake_jobs[i].job == nullptr && free_slot < 0)
+        {
+            free_slot = i;
+        }
+    }
+    if (free_slot >= 0)
+    {
+        radio_wake_jobs[free_slot] = {.job = job, .due_ms = due_ms};
+    }
+    else
+    {
+        Serial.printf("No radio wake slot for %s\n", job);
+    }
+    xSemaphoreGive(radio_power_mutex);
+}
+
+void radio_power_cancel_wake(const char *job)
+{
+    xSemaphoreTake(radio_power_mutex, portMAX_DELAY);
+    for (int i = 0; i < MAX_RADIO_WAKE_JOBS; i++)
+    {
+        if (radio_wake_jobs[i].job == job)
+        {
+            radio_wake_jobs[i] = {};
+        }
+    }
+    xSemaphoreGive(radio_power_mutex);
+}
+
+void radio_power_update(void)
+{
+    xSemaphoreTake(radio_power_mutex, portMAX_DELAY);
+    uint32_t now = millis();
+    // A wake that is well past due belongs to a job that has run or stopped
+    for (int i = 0; i < MAX_RADIO_WAKE_JOBS; i++)
+    {
+        if (radio_wake_jobs[i].job != nullptr && (int32_t)(now - radio_wake_jobs[i].due_ms) > (int32_t)RADIO_WAKE_LEAD_MS)
+        {
+            radio_wake_jobs[i] = {};
+        }
+    }
+    apply_radio_power();
+    xSemaphoreGive(radio_power_mutex);
+}
+
+uint32_t radio_power_poll_interval_ms(uint32_t base_interval_ms)
+{
+    return current_radio_power_profile == RADIO_POWER_SAVER ? base_interval_ms * RADIO_SAVER_POLL_MULTIPLIER : base_interval_ms;
+}
+
+radio_power_stats radio_power_get_stats(void)
+{
+    xSemaphoreTake(radio_power_mutex, portMAX_DELAY);
+    account_radio_time(millis());
+    radio_power_stats stats = {
+        .profile = current_radio_power_profile,
+        .awake = radio_awake,
+        .awake_ms_this_hour = radio_awake_ms_this_hour,
+        .awake_ms_last_hour = radio_awake_ms_last_hour,
+        .wakeups = radio_wakeups,
+    };
+    xSemaphoreGive(radio_power_mutex);
+    return stats;
+}
+
+const char *radio_power_profile_str(radio_power_profile profile)
+{
+    switch (profile)
+    {
+    case RADIO_POWER_PERFORMANCE:
+        return "performance";
+    case RADIO_POWER_BALANCED:
+        return "balanced";
+    case RADIO_POWER_SAVER:
+        return "saver";
+    }
+    return "unknown";
+}
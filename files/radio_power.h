@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+
+enum radio_power_profile
+{
+    RADIO_POWER_PERFORMANCE, // radio always awake, base poll cadence
+    RADIO_POWER_BALANCED,    // modem sleep between network jobs, base poll cadence
+    RADIO_POWER_SAVER,       // modem sleep between network jobs, slower poll cadence
+};
+
+struct radio_power_stats
+{
+    radio_power_profile profile;
+    bool awake;
+    uint32_t awake_ms_this_hour;
+    uint32_t awake_ms_last_hour;
+    uint32_t wakeups;
+};
+
+void radio_power_begin(radio_power_profile profile);
+void radio_power_set_profile(radio_power_profile profile);
+// Keeps the radio fully awake while a request is in flight
+void radio_power_acquire(void);
+void radio_power_release(void);
+// Wakes the radio shortly before a job is due, a job has at most one pending wake
+void radio_power_schedule_wake(const char *job, uint32_t due_ms);
+void radio_power_cancel_wake(const char *job);
+// Applies the power save mode for the current schedule, call it regularly
+void radio_power_update(void);
+uint32_t radio_power_poll_interval_ms(uint32_t base_interval_ms);
+radio_power_stats radio_power_get_stats(void);
+const char *radio_power_profile_str(radio_power_profile profile);
+
+struct radio_power_lock
+{
+    radio_power_lock() { radio_power_acquire(); }
+    ~radio_power_lock() { radio_power_release(); }
+};
@@ -0,0 +1,47 @@
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "request_context.h"
+
+const uint32_t CANCEL_TOKEN_POLL_MS = 50;
+
+bool cancel_token::sleep_ms(uint32_t ms) const
+{
+    uint32_t started_ms = millis();
+    while (!is_cancelled())
+    {
+        uint32_t elapsed_ms = millis() - started_ms;
+        if (elapsed_ms >= ms)
+        {
+            return true;
+        }
+        vTaskDelay(pdMS_TO_TICKS(min(ms - elapsed_ms, CANCEL_TOKEN_POLL_MS)));
+    }
+    return false;
+}
+
+bool request_context::is_expired(void) const
+{
+    return (int32_t)(millis() - deadline_ms) >= 0;
+}
+
+uint32_t request_context::remaining_ms(void) const
+{
+    int32_t remaining = (int32_t)(deadline_ms - millis());
+    return remaining > 0 ? remaining : 0;
+}
+
+bool request_context::sleep_ms(uint32_t ms) const
+{
+    if (cancel == nullptr)
+    {
+        vTaskDelay(pdMS_TO_TICKS(ms));
+        return true;
+    }
+    return cancel->sleep_ms(ms);
+}
+
+request_context make_request_context(uint32_t timeout_ms, const cancel_token *cancel)
+{
+    return {.deadline_ms = millis() + timeout_ms, .cancel = cancel};
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Set from another task to abandon the requests of a task, checked between the phases of a request
+struct cancel_token
+{
+    std::atomic<bool> cancelled{false};
+
+    void cancel(void) { cancelled = true; }
+    void reset(void) { cancelled = false; }
+    bool is_cancelled(void) const { return cancelled; }
+    // Like vTaskDelay, but returns false as soon as the token is cancelled
+    bool sleep_ms(uint32_t ms) const;
+};
+
+// Deadline and cancellation of one request, including its retries
+struct request_context
+{
+    uint32_t deadline_ms;
+    const cancel_token *cancel;
+
+    bool is_cancelled(void) const { return cancel != nullptr && cancel->is_cancelled(); }
+    bool is_expired(void) const;
+    bool should_stop(void) const { return is_cancelled() || is_expired(); }
+    uint32_t remaining_ms(void) const;
+    const char *stop_reason(void) const { return is_cancelled() ? "cancelled" : "deadline exceeded"; }
+    // Like vTaskDelay, but returns false as soon as the request is cancelled
+    bool sleep_ms(uint32_t ms) const;
+};
+
+request_context make_request_context(uint32_t timeout_ms, const cancel_token *cancel = nullptr);
@@ -0,0 +1,82 @@
+#include <Arduino.h>
+#include <cstring>
+#include "serial_commands.h"
+#include "http_metrics.h"
+#include <lvgl.h>
+#include "stock_widget.h"
+
+const size_t SERIAL_COMMAND_MAX_LENGTH = 64;
+
+static char serial_command_line[SERIAL_COMMAND_MAX_LENGTH];
+static size_t serial_command_length = 0;
+
+static void run_serial_command(const char *command)
+{
+    if (strcmp(command, "net") == 0)
+    {
+        http_metrics_print(Serial);
+    }
+    else if (strcmp(command, "net reset") == 0)
+    {
+        http_metrics_reset();
+        Serial.println("HTTP metrics cleared");
+    }
+    else if (strcmp(command, "chart") == 0)
+    {
+        stock_widget_print_chart_stats();
+    }
+    else if (strcmp(command, "chart line") == 0 || strcmp(command, "chart candles") == 0)
+    {
+        lv_lock();
+        stock_widget_set_chart_candles(strcmp(command, "chart candles") == 0);
+        lv_unlock();
+        stock_widget_print_chart_stats();
+    }
+    else if (strcmp(command, "chart bench") == 0)
+    {
+        stock_widget_bench_chart();
+    }
+    else if (strcmp(command, "source") == 0)
+    {
+        stock_widget_print_data_source();
+    }
+    else if (strncmp(command, "source ", 7) == 0)
+    {
+        if (!stock_widget_set_data_source(command + 7))
+        {
+            Serial.printf("Unknown stock data source '%s'\n", command + 7);
+            stock_widget_print_data_source();
+        }
+    }
+    else if (strcmp(command, "help") == 0)
+    {
+        Serial.println("net           per endpoint latency histograms, rssi and error counts");
+        Serial.println("net reset     clear the recorded requests");
+        Serial.println("chart         stock chart style and redraw counts");
+        Serial.println("chart line    draw the stock chart as a line, chart candles as candles");
+        Serial.println("chart bench   time a data update and a static frame of both chart styles");
+        Serial.println("source        stock data source, source <name> refetches every ticker from another");
+    }
+    else if (command[0] != '\0')
+    {
+        Serial.printf("Unknown command '%s', try help\n", command);
+    }
+}
+
+void serial_commands_poll(void)
+{
+    while (Serial.available() > 0)
+    {
+        int c = Serial.read();
+        if (c == '\r' || c == '\n')
+        {
+            serial_command_line[serial_command_length] = '\0';
+            run_serial_command(serial_command_line);
+            serial_command_length = 0;
+        }
+        else if (serial_command_length < SERIAL_COMMAND_MAX_LENGTH - 1)
+        {
+            serial_command_line[serial_command_length++] = (char)c;
+        }
+    }
+}
@@ -0,0 +1,4 @@
+#pragma once
+
+// Reads commands typed into the serial monitor without blocking, "help" lists them
+void serial_commands_poll(void);
@@ -0,0 +1,418 @@
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <algorithm>
+#include <cstring>
+#include <esp_heap_caps.h>
+#include "stock_data_source.h"
+#include "stock_fixture_data.h"
+#include "config.h"
+#include "utils.h"
+#include "http_policy.h"
+#include "market_calendar.h"
+
+const bool DEBUG_API_REQUESTS = true;
+const uint16_t STOCK_SYNTHETIC_FIRST_DAY = 18262; // 2020-01-01, every walk starts there so a day always gets the same bar
+const float STOCK_SYNTHETIC_DAILY_VOLATILITY = 0.02f;
+
+static std::pair<bool, JsonDocument> send_http_request_stock(const std::string serverEndpoint, const std::string http_method, const std::string payload="")
+{
+    return send_http_request(serverEndpoint, http_method, payload,{}, DEBUG_API_REQUESTS);
+}
+
+// Only the bars from from_day on are requested, which is the newest cached day on a warm cache
+static std::pair<bool, std::vector<stock_bar>> request_stock_bars(const std::string &ticker, uint16_t from_day)
+{
+    std::string from_str = epoch_day_to_date_str(from_day);
+    if (DEBUG_API_REQUESTS)
+    {
+        Serial.printf("Requesting %s bars from %s\n", ticker.c_str(), from_str.c_str());
+    }
+
+    std::string serverEndpoint = (String(STOCK_API_BASE_URL "/historical-price-eod/full?") +
+                                  "symbol=" + String(ticker.c_str()) + "&apikey=" + String(STOCK_API_KEY) + "&from=" + String(from_str.c_str()))
+                                     .c_str();
+
+    auto [doc_valid, doc] = send_http_request_stock(serverEndpoint, "GET");
+
+    if (!doc_valid)
+    {
+        return {false, {}};
+    }
+
+    std::vector<stock_bar> bars;
+    for (JsonObject entry : doc.as<JsonArray>())
+    {
+        uint16_t epoch_day = entry["date"] ? date_str_to_epoch_day(entry["date"].as<std::string>()) : 0;
+        if (epoch_day == 0)
+        {
+            continue;
+        }
+        bars.push_back({
+            .epoch_day = epoch_day,
+            .open_price = entry["open"] ? entry["open"].as<float>() : 0.0f,
+            .close_price = entry["close"] ? entry["close"].as<float>() : 0.0f,
+            .high_price = entry["high"] | 0.0f,
+            .low_price = entry["low"] | 0.0f,
+            .volume = entry["volume"] | 0u,
+        });
+    }
+    return {true, bars};
+}
+
+// Bars come precomputed from tools/gateway as [epoch day, open, close, high, low, volume], newest first.
+// Falls back to FMP when the gateway cannot be reached
+static std::pair<bool, std::vector<stock_bar>> request_stock_bars_gateway(const std::string &ticker, uint16_t from_day)
+{
+    std::string serverEndpoint = std::string(GATEWAY_URL "/v1/stock?symbol=") + ticker + "&from=" + std::to_string(from_day);
+    auto [doc_valid, doc] = send_http_request(serverEndpoint, "GET", "", {{"Accept", "application/msgpack"}}, DEBUG_API_REQUESTS);
+
+    if (!doc_valid)
+    {
+        Serial.println("Gateway unavailable, requesting stock data directly");
+        return request_stock_bars(ticker, from_day);
+    }
+
+    std::vector<stock_bar> bars;
+    for (JsonArray bar : doc["bars"].as<JsonArray>())
+    {
+        bars.push_back({
+            .epoch_day = bar[0].as<uint16_t>(),
+            .open_price = bar[1].as<float>(),
+            .close_price = bar[2].as<float>(),
+            .high_price = bar[3] | 0.0f,
+            .low_price = bar[4] | 0.0f,
+            .volume = bar[5] | 0u,
+        });
+    }
+    return {true, bars};
+}
+
+static std::string join_tickers(const std::vector<std::string> &tickers)
+{
+    std::string joined;
+    for (const std::string &ticker : tickers)
+    {
+        joined += (joined.empty() ? "" : ",") + ticker;
+    }
+    return joined;
+}
+
+// One request for the quotes of every ticker, FMP takes a comma separated symbol list
+static std::pair<bool, std::vector<stock_quote_item>> request_stock_quotes(const std::vector<std::string> &tickers)
+{
+    std::string serverEndpoint = std::string(STOCK_API_BASE_URL "/batch-quote?symbols=") + join_tickers(tickers) + "&apikey=" + STOCK_API_KEY;
+    auto [doc_valid, doc] = send_http_request_stock(serverEndpoint, "GET");
+
+    if (!doc_valid)
+    {
+        return {false, {}};
+    }
+
+    std::vector<stock_quote_item> quotes;
+    time_t now = time(nullptr);
+    for (JsonObject entry : doc.as<JsonArray>())
+    {
+        quotes.push_back({
+            .ticker = entry["symbol"] | "",
+            .name = entry["name"] | "",
+            .quote = {
+                .price = entry["price"] | 0.0f,
+                .change = entry["change"] | 0.0f,
+                .percent_change = entry["changePercentage"] | 0.0f,
+                .epoch_day = (uint16_t)((entry["timestamp"] | (time_t)0) / (24 * 60 * 60)),
+                .updated_at = now,
+            },
+        });
+    }
+    return {true, quotes};
+}
+
+// Quotes come from tools/gateway as [symbol, name, price, change, percent change, timestamp]
+static std::pair<bool, std::vector<stock_quote_item>> request_stock_quotes_gateway(const std::vector<std::string> &tickers)
+{
+    std::string serverEndpoint = std::string(GATEWAY_URL "/v1/quotes?symbols=") + join_tickers(tickers);
+    auto [doc_valid, doc] = send_http_request(serverEndpoint, "GET", "", {{"Accept", "application/msgpack"}}, DEBUG_API_REQUESTS);
+
+    if (!doc_valid)
+    {
+        Serial.println("Gateway unavailable, requesting stock quotes directly");
+        return request_stock_quotes(tickers);
+    }
+
+    std::vector<stock_quote_item> quotes;
+    time_t now = time(nullptr);
+    for (JsonArray quote : doc["quotes"].as<JsonArray>())
+    {
+        quotes.push_back({
+            .ticker = quote[0] | "",
+            .name = quote[1] | "",
+            .quote = {
+                .price = quote[2] | 0.0f,
+                .change = quote[3] | 0.0f,
+                .percent_change = quote[4] | 0.0f,
+                .epoch_day = (uint16_t)((quote[5] | (time_t)0) / (24 * 60 * 60)),
+                .updated_at = now,
+            },
+        });
+    }
+    return {true, quotes};
+}
+
+static std::pair<bool, std::vector<stock_bar>> fetch_live_bars(const std::string &ticker, uint16_t from_day)
+{
+    return gateway_enabled() ? request_stock_bars_gateway(ticker, from_day) : request_stock_bars(ticker, from_day);
+}
+
+static std::pair<bool, std::vector<stock_quote_item>> fetch_live_quotes(const std::vector<std::string> &tickers)
+{
+    return gateway_enabled() ? request_stock_quotes_gateway(tickers) : request_stock_quotes(tickers);
+}
+
+static bool is_live_rate_limited(void)
+{
+    return http_policy_is_rate_limited(http_policy_host_from_url(gateway_enabled() ? GATEWAY_URL : STOCK_API_BASE_URL));
+}
+
+// Days to add to recorded bars so the newest one falls into the current week. Whole weeks keep the
+// weekdays, so the weekends stay without bars
+static int rebase_days(uint16_t newest_day)
+{
+    int days = (int)get_today_epoch_day() - newest_day;
+    return days > 0 ? days / 7 * 7 : 0;
+}
+
+// A ticker without a recording gets the first one, like tools/mock_api does
+static const stock_fixture &find_fixture(const std::string &ticker)
+{
+    for (const stock_fixture &fixture : STOCK_FIXTURES)
+    {
+        if (ticker == fixture.ticker)
+        {
+            return fixture;
+        }
+    }
+    return STOCK_FIXTURES[0];
+}
+
+static std::pair<bool, std::vector<stock_bar>> fetch_fixture_bars(const std::string &ticker, uint16_t from_day)
+{
+    const stock_fixture &fixture = find_fixture(ticker);
+    int shift = rebase_days(fixture.bars[0].epoch_day);
+    std::vector<stock_bar> bars;
+    for (size_t i = 0; i < fixture.bar_count && fixture.bars[i].epoch_day + shift >= from_day; i++)
+    {
+        bars.push_back(fixture.bars[i]);
+        bars.back().epoch_day += shift;
+    }
+    return {true, bars};
+}
+
+static std::pair<bool, std::vector<stock_quote_item>> fetch_fixture_quotes(const std::vector<std::string> &tickers)
+{
+    std::vector<stock_quote_item> quotes;
+    time_t now = time(nullptr);
+    for (const std::string &ticker : tickers)
+    {
+        const stock_fixture &fixture = find_fixture(ticker);
+        stock_quote_item item = {
+            .ticker = ticker,
+            .name = ticker == fixture.ticker ? fixture.name : ticker + " (fixture)",
+            .quote = fixture.quote,
+        };
+        item.quote.epoch_day += rebase_days(fixture.bars[0].epoch_day);
+        item.quote.updated_at = now;
+        quotes.push_back(item);
+    }
+    return {true, quotes};
+}
+
+// The cache of the ticker in a temporary history in psram, nullptr when there is none. Free it when done
+static stock_history *load_recording(const std::string &ticker)
+{
+    stock_history *history = (stock_history *)heap_caps_malloc(sizeof(stock_history), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (history == nullptr)
+    {
+        Serial.printf("Replaying %s: allocating %u bytes failed\n", ticker.c_str(), sizeof(stock_history));
+        return nullptr;
+    }
+    stock_history_init(history, ticker);
+    if (!stock_history_load(history) || history->series.count == 0)
+    {
+        Serial.printf("Replaying %s: no recording, run the live source first\n", ticker.c_str());
+        free(history);
+        return nullptr;
+    }
+    return history;
+}
+
+static stock_bar bar_from_series(const stock_series &series, size_t index, int shift)
+{
+    stock_fixed_bar bar = stock_series_bar(series, index);
+    return {
+        .epoch_day = (uint16_t)(bar.epoch_day + shift),
+        .open_price = stock_price_from_fixed(bar.open),
+        .close_price = stock_price_from_fixed(bar.close),
+        .high_price = stock_price_from_fixed(bar.high),
+        .low_price = stock_price_from_fixed(bar.low),
+        .volume = bar.volume,
+    };
+}
+
+static std::pair<bool, std::vector<stock_bar>> fetch_replay_bars(const std::string &ticker, uint16_t from_day)
+{
+    stock_history *history = load_recording(ticker);
+    if (history == nullptr)
+    {
+        return {false, {}};
+    }
+    const stock_series &series = history->series;
+    int shift = rebase_days(stock_series_day(series, series.count - 1));
+    std::vector<stock_bar> bars;
+    for (size_t i = series.count; i > 0 && stock_series_day(series, i - 1) + shift >= from_day; i--)
+    {
+        bars.push_back(bar_from_series(series, i - 1, shift));
+    }
+    free(history);
+    return {true, bars};
+}
+
+// The close of the newest recorded bar, the change is the one since the bar before
+static std::pair<bool, std::vector<stock_quote_item>> fetch_replay_quotes(const std::vector<std::string> &tickers)
+{
+    std::vector<stock_quote_item> quotes;
+    time_t now = time(nullptr);
+    for (const std::string &ticker : tickers)
+    {
+        stock_history *history = load_recording(ticker);
+        if (history == nullptr)
+        {
+            continue;
+        }
+        const stock_series &series = history->series;
+        int shift = rebase_days(stock_series_day(series, series.count - 1));
+        stock_bar last = bar_from_series(series, series.count - 1, shift);
+        float previous_close = series.count > 1 ? bar_from_series(series, series.count - 2, shift).close_price : last.open_price;
+        quotes.push_back({
+            .ticker = ticker,
+            .name = history->name,
+            .quote = {
+                .price = last.close_price,
+                .change = last.close_price - previous_close,
+                .percent_change = previous_close != 0.0f ? (last.close_price - previous_close) / previous_close * 100.0f : 0.0f,
+                .epoch_day = last.epoch_day,
+                .updated_at = now,
+            },
+        });
+        free(history);
+    }
+    return {!quotes.empty() || tickers.empty(), quotes};
+}
+
+// FNV-1a of the ticker, so every ticker walks its own way
+static uint32_t synthetic_seed(const std::string &ticker)
+{
+    uint32_t hash = 2166136261u;
+    for (char c : ticker)
+    {
+        hash = (hash ^ (uint8_t)c) * 16777619u;
+    }
+    return hash != 0 ? hash : 1;
+}
+
+// xorshift32, uniform in [0, 1)
+static float synthetic_random(uint32_t *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return (*state >> 8) / 16777216.0f;
+}
+
+// Weekday bars of a random walk from STOCK_SYNTHETIC_FIRST_DAY up to today, newest first, the ones before
+// from_day left out
+static std::vector<stock_bar> synthetic_bars(const std::string &ticker, uint16_t from_day)
+{
+    uint32_t state = synthetic_seed(ticker);
+    float close = 20.0f + state % 400;
+    uint32_t volume_base = 1000000u * (5 + state % 50);
+    std::vector<stock_bar> bars;
+    for (uint16_t day = STOCK_SYNTHETIC_FIRST_DAY; day <= get_today_epoch_day(); day++)
+    {
+        int weekday = epoch_day_weekday(day);
+        if (weekday == 0 || weekday == 6)
+        {
+            continue;
+        }
+        // The sum of three uniforms is close enough to a normal distribution
+        float move = (synthetic_random(&state) + synthetic_random(&state) + synthetic_random(&state) - 1.5f) * 2.0f * STOCK_SYNTHETIC_DAILY_VOLATILITY;
+        float open = close * (1.0f + (synthetic_random(&state) - 0.5f) * STOCK_SYNTHETIC_DAILY_VOLATILITY / 2);
+        close = max(open * (1.0f + move), 1.0f);
+        float high = max(open, close) * (1.0f + synthetic_random(&state) * STOCK_SYNTHETIC_DAILY_VOLATILITY / 2);
+        float low = min(open, close) * (1.0f - synthetic_random(&state) * STOCK_SYNTHETIC_DAILY_VOLATILITY / 2);
+        uint32_t volume = volume_base / 2 + (uint32_t)(synthetic_random(&state) * volume_base);
+        if (day >= from_day)
+        {
+            bars.push_back({day, open, close, high, low, volume});
+        }
+    }
+    std::reverse(bars.begin(), bars.end());
+    return bars;
+}
+
+static std::pair<bool, std::vector<stock_bar>> fetch_synthetic_bars(const std::string &ticker, uint16_t from_day)
+{
+    return {true, synthetic_bars(ticker, from_day)};
+}
+
+static std::pair<bool, std::vector<stock_quote_item>> fetch_synthetic_quotes(const std::vector<std::string> &tickers)
+{
+    std::vector<stock_quote_item> quotes;
+    time_t now = time(nullptr);
+    for (const std::string &ticker : tickers)
+    {
+        // Two weeks hold at least two bars
+        std::vector<stock_bar> bars = synthetic_bars(ticker, get_today_epoch_day() - 14);
+        float previous_close = bars[1].close_price;
+        quotes.push_back({
+            .ticker = ticker,
+            .name = ticker + " (synthetic)",
+            .quote = {
+                .price = bars[0].close_price,
+                .change = bars[0].close_price - previous_close,
+                .percent_change = (bars[0].close_price - previous_close) / previous_close * 100.0f,
+                .epoch_day = bars[0].epoch_day,
+                .updated_at = now,
+            },
+        });
+    }
+    return {true, quotes};
+}
+
+static const stock_data_source STOCK_DATA_SOURCES[] = {
+    {"live", fetch_live_bars, fetch_live_quotes, true, is_live_rate_limited},
+    {"fixture", fetch_fixture_bars, fetch_fixture_quotes, false, nullptr},
+    {"replay", fetch_replay_bars, fetch_replay_quotes, false, nullptr},
+    {"synthetic", fetch_synthetic_bars, fetch_synthetic_quotes, false, nullptr},
+};
+
+const stock_data_source *stock_data_source_find(const char *name)
+{
+    for (const stock_data_source &source : STOCK_DATA_SOURCES)
+    {
+        if (strcmp(source.name, name) == 0)
+        {
+            return &source;
+        }
+    }
+    return nullptr;
+}
+
+const stock_data_source *stock_data_source_at(size_t index)
+{
+    return index < stock_data_source_count() ? &STOCK_DATA_SOURCES[index] : nullptr;
+}
+
+size_t stock_data_source_count(void)
+{
+    return sizeof(STOCK_DATA_SOURCES) / sizeof(STOCK_DATA_SOURCES[0]);
+}
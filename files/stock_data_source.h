@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstddef>
+#include "stock_watchlist.h"
+
+// Logs the requests of the live source and what the refresh task merged from any source
+extern const bool DEBUG_API_REQUESTS;
+
+struct stock_quote_item
+{
+    std::string ticker;
+    std::string name;
+    stock_quote quote;
+};
+
+// Where the stock widget gets its bars and quotes from. The refresh task fetches only through the selected
+// source, so every source is exercised by the same merge, render and state code
+struct stock_data_source
+{
+    const char *name;
+    // Bars from from_day on, newest first like the apis
+    std::pair<bool, std::vector<stock_bar>> (*fetch_bars)(const std::string &ticker, uint16_t from_day);
+    std::pair<bool, std::vector<stock_quote_item>> (*fetch_quotes)(const std::vector<std::string> &tickers);
+    bool is_live; // fetches over the network, and only its histories are written to the flash cache
+    // True while the request budget of the source is used up, nullptr for sources without one. A fetch
+    // then would be skipped locally, which says nothing about the data
+    bool (*is_rate_limited)(void);
+};
+
+// Bars and quote of one recorded ticker, decoded from json by tools/stock_fixture/stock_fixture_gen.py
+struct stock_fixture
+{
+    const char *ticker;
+    const char *name;
+    const stock_bar *bars; // newest first
+    size_t bar_count;
+    stock_quote quote;
+};
+
+// live:      FMP, or tools/gateway when GATEWAY_URL is set
+// fixture:   the bars of stock_fixture_data.h from flash, no parsing
+// replay:    the flash cache an earlier live run recorded, read only
+// synthetic: a seeded random walk per ticker, the same bars for the same ticker and day
+// Fixture and replay bars are moved by whole weeks so the newest one falls into the current week
+const stock_data_source *stock_data_source_find(const char *name);
+const stock_data_source *stock_data_source_at(size_t index);
+size_t stock_data_source_count(void);
@@ -0,0 +1,33 @@
+// Generated by tools/stock_fixture/stock_fixture_gen.py from fmp_historical_price_eod_full.json and fmp_batch_quote.json, do not edit
+#pragma once
+
+#include "stock_data_source.h"
+
+const stock_bar STOCK_FIXTURE_BARS_TSLA[] = {
+    {20362, 443.8f, 459.46f, 462.29f, 440.75f, 97498810u},
+    {20361, 441.52f, 444.72f, 445.0f, 433.12f, 74358000u},
+    {20360, 444.35f, 443.21f, 450.98f, 439.5f, 79491510u},
+    {20357, 428.3f, 440.4f, 440.47f, 421.02f, 101628200u},
+    {20356, 435.24f, 423.39f, 435.35f, 419.08f, 96746426u},
+    {20355, 429.83f, 442.79f, 444.21f, 429.03f, 93133600u},
+    {20354, 439.88f, 425.85f, 440.97f, 423.72f, 83422700u},
+    {20353, 431.11f, 434.21f, 444.98f, 429.13f, 97108800u},
+    {20350, 421.82f, 426.07f, 429.47f, 421.72f, 93131034u},
+    {20349, 428.87f, 416.85f, 432.22f, 416.56f, 90454509u},
+    {20348, 415.75f, 425.86f, 428.31f, 409.67f, 106133532u},
+    {20347, 414.5f, 421.62f, 423.25f, 411.43f, 104285721u},
+    {20346, 423.13f, 410.04f, 425.7f, 402.43f, 163823700u},
+    {20343, 370.94f, 395.94f, 396.69f, 370.24f, 168156400u},
+    {20342, 350.17f, 368.81f, 368.99f, 347.6f, 103756010u},
+    {20341, 350.55f, 347.79f, 356.33f, 346.07f, 72121700u},
+    {20340, 348.44f, 346.97f, 350.77f, 343.82f, 53816000u},
+    {20339, 354.64f, 346.4f, 358.44f, 344.84f, 75208300u},
+    {20336, 348.0f, 350.84f, 355.87f, 344.68f, 108989800u},
+    {20335, 336.15f, 338.53f, 338.89f, 331.48f, 60711033u},
+    {20334, 335.2f, 334.09f, 343.33f, 328.51f, 88733300u},
+    {20333, 328.23f, 329.36f, 333.33f, 325.6f, 58392000u},
+};
+
+const stock_fixture STOCK_FIXTURES[] = {
+    {"TSLA", "Tesla, Inc.", STOCK_FIXTURE_BARS_TSLA, sizeof(STOCK_FIXTURE_BARS_TSLA) / sizeof(stock_bar), {459.46f, 14.74f, 3.31f, 20362, 0}},
+};
@@ -0,0 +1,177 @@
+#include <Arduino.h>
+#include <algorithm>
+#include "stock_history.h"
+#include "widget_state_store.h"
+
+const uint8_t STOCK_HISTORY_STATE_VERSION = 5;
+
+// A watchlist of histories outgrows NVS, they are files on the SPIFFS partition
+static std::string history_state_path(const char *ticker)
+{
+    return std::string("/h_") + ticker;
+}
+
+static void copy_truncated(char *destination, size_t max_length, const std::string &source)
+{
+    size_t length = min(source.size(), max_length);
+    memcpy(destination, source.data(), length);
+    destination[length] = '\0';
+}
+
+void stock_history_init(stock_history *history, const std::string &ticker)
+{
+    memset(history, 0, sizeof(stock_history));
+    copy_truncated(history->ticker, STOCK_TICKER_MAX_LENGTH, ticker);
+}
+
+uint16_t stock_history_fetch_from_day(const stock_history &history, uint16_t window_start_day)
+{
+    const stock_series &series = history.series;
+    if (series.count == 0 || stock_series_day(series, series.count - 1) < window_start_day)
+    {
+        return window_start_day;
+    }
+    return stock_series_day(series, series.count - 1);
+}
+
+bool stock_history_merge(stock_history *history, const std::vector<stock_bar> &bars)
+{
+    // The apis answer newest first, the series is filled oldest first
+    std::vector<stock_bar> sorted = bars;
+    std::sort(sorted.begin(), sorted.end(), [](const stock_bar &a, const stock_bar &b)
+              { return a.epoch_day < b.epoch_day; });
+
+    stock_series *series = &history->series;
+    bool changed = false;
+    size_t first_replaced = SIZE_MAX;
+    for (const stock_bar &bar : sorted)
+    {
+        stock_fixed_bar fixed = {
+            .epoch_day = bar.epoch_day,
+            .open = stock_price_to_fixed(bar.open_price),
+            .close = stock_price_to_fixed(bar.close_price),
+            .high = stock_price_to_fixed(bar.high_price),
+            .low = stock_price_to_fixed(bar.low_price),
+            .volume = bar.volume,
+        };
+        if (series->count == 0 || bar.epoch_day > stock_series_day(*series, series->count - 1))
+        {
+            stock_series_append(series, fixed);
+            changed = true;
+            continue;
+        }
+        // The cache only grows at the new end, a bar before it can only replace a cached day
+        size_t index = stock_series_lower_bound(*series, bar.epoch_day);
+        if (index < series->count && stock_series_day(*series, index) == bar.epoch_day)
+        {
+            // Compared after setting, which widens high and low the same way as the cached bar
+            stock_fixed_bar cached = stock_series_bar(*series, index);
+            stock_series_set(series, index, fixed);
+            fixed = stock_series_bar(*series, index);
+            if (cached.open != fixed.open || cached.close != fixed.close || cached.high != fixed.high || cached.low != fixed.low || cached.volume != fixed.volume)
+            {
+                changed = true;
+                first_replaced = min(first_replaced, index);
+            }
+        }
+    }
+
+    // Usually only the newest cached bar is replaced, which recomputes one period
+    if (first_replaced != SIZE_MAX)
+    {
+        stock_indicators_recompute_from(&history->indicators, *series, first_replaced);
+    }
+    else
+    {
+        stock_indicators_append(&history->indicators, *series);
+    }
+    return changed;
+}
+
+bool stock_history_trim(stock_history *history, uint16_t oldest_day)
+{
+    size_t dropped = stock_series_lower_bound(history->series, oldest_day);
+    stock_series_drop_oldest(&history->series, dropped);
+    if (dropped > 0)
+    {
+        // The rolling sums may have covered dropped bars
+        stock_indicators_recompute_from(&history->indicators, history->series, history->series.count);
+    }
+    return dropped > 0;
+}
+
+void stock_history_set_name(stock_history *history, const std::string &name)
+{
+    copy_truncated(history->name, STOCK_NAME_MAX_LENGTH, name);
+}
+
+bool stock_history_save(stock_history *history)
+{
+    state_writer writer;
+    const stock_series &series = history->series;
+    writer.buffer.reserve(64 + series.count * 22);
+    writer.write_string(history->ticker);
+    writer.write_string(history->name);
+    writer.write_u16(series.count);
+    for (size_t i = 0; i < series.count; i++)
+    {
+        writer.write_u16(stock_series_day(series, i));
+        writer.write_i32(stock_series_open(series, i));
+        writer.write_i32(stock_series_close(series, i));
+        writer.write_i32(stock_series_high(series, i));
+        writer.write_i32(stock_series_low(series, i));
+        writer.write_u32(stock_series_volume(series, i));
+    }
+    if (!save_widget_state_file(history_state_path(history->ticker).c_str(), STOCK_HISTORY_STATE_VERSION, writer))
+    {
+        return false;
+    }
+    history->saved_at = time(nullptr);
+    return true;
+}
+
+void stock_history_erase_nvs_caches(void)
+{
+    erase_widget_states_with_prefix("h_");
+}
+
+bool stock_history_load(stock_history *history)
+{
+    std::string ticker = history->ticker;
+    stock_history_init(history, ticker);
+    auto [is_state_valid, state] = load_widget_state_file(history_state_path(ticker.c_str()).c_str(), STOCK_HISTORY_STATE_VERSION);
+    if (!is_state_valid)
+    {
+        return false;
+    }
+
+    state_reader reader = {.data = state.payload.data(), .size = state.payload.size()};
+    if (reader.read_string() != ticker)
+    {
+        Serial.printf("Stock history of %s is not ours, ignoring it\n", ticker.c_str());
+        return false;
+    }
+    stock_history_set_name(history, reader.read_string());
+    size_t count = reader.read_u16();
+    // A cache saved with a larger STOCK_HISTORY_DAYS keeps its newest bars
+    for (size_t i = 0; i < count; i++)
+    {
+        stock_fixed_bar bar;
+        bar.epoch_day = reader.read_u16();
+        bar.open = reader.read_i32();
+        bar.close = reader.read_i32();
+        bar.high = reader.read_i32();
+        bar.low = reader.read_i32();
+        bar.volume = reader.read_u32();
+        stock_series_append(&history->series, bar);
+    }
+    stock_indicators_append(&history->indicators, history->series);
+    if (!reader.ok)
+    {
+        Serial.printf("Stock history of %s is corrupted, ignoring it\n", ticker.c_str());
+        stock_history_init(history, ticker);
+        return false;
+    }
+    history->saved_at = state.saved_at;
+    return true;
+}
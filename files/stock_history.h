@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include "stock_series.h"
+#include "stock_indicators.h"
+
+const size_t STOCK_TICKER_MAX_LENGTH = 12;
+const size_t STOCK_NAME_MAX_LENGTH = 31;
+
+// One bar as the apis deliver it, stored in the history as fixed point columns
+struct stock_bar
+{
+    uint16_t epoch_day;
+    float open_price;
+    float close_price;
+    float high_price; // 0 when the api does not tell
+    float low_price;
+    uint32_t volume;
+};
+
+// Daily bars of one ticker, persisted per ticker so a refresh only has to fetch what is new. Plain data
+// without heap members, so a whole watchlist is one allocation of known size.
+struct stock_history
+{
+    char ticker[STOCK_TICKER_MAX_LENGTH + 1];
+    char name[STOCK_NAME_MAX_LENGTH + 1];
+    stock_series series;
+    stock_indicators indicators; // follows every change of the series
+    time_t saved_at;
+};
+
+void stock_history_init(stock_history *history, const std::string &ticker);
+// First day to request: the newest cached day, whose bar may still have been forming when it was fetched,
+// or the window start when the cache is empty or does not reach into the window
+uint16_t stock_history_fetch_from_day(const stock_history &history, uint16_t window_start_day);
+// Bars newer than the cache are appended, overwriting the oldest when the ring is full, a bar for a day
+// already cached replaces it. True when anything changed
+bool stock_history_merge(stock_history *history, const std::vector<stock_bar> &bars);
+// Drops the bars before oldest_day. True when any were dropped
+bool stock_history_trim(stock_history *history, uint16_t oldest_day);
+void stock_history_set_name(stock_history *history, const std::string &name);
+bool stock_history_save(stock_history *history);
+// Loads the cache of the history's ticker in place, the history is left empty when there is none
+bool stock_history_load(stock_history *history);
+// The caches of the first formats were NVS blobs h_<ticker>, they are erased at boot to free the partition
+void stock_history_erase_nvs_caches(void);
@@ -0,0 +1,166 @@
+#include <Arduino.h>
+#include "stock_indicators.h"
+
+static int64_t rounded_div(int64_t dividend, int64_t divisor)
+{
+    return (dividend + (dividend >= 0 ? divisor / 2 : -divisor / 2)) / divisor;
+}
+
+static uint32_t isqrt(uint64_t value)
+{
+    uint64_t root = 0;
+    uint64_t bit = 1ull << 62;
+    while (bit > value)
+    {
+        bit >>= 2;
+    }
+    while (bit != 0)
+    {
+        if (value >= root + bit)
+        {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        }
+        else
+        {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return root;
+}
+
+static uint32_t oldest_sequence(const stock_series &series)
+{
+    return series.next_sequence - series.count;
+}
+
+static int64_t typical_price(const stock_series &series, size_t index)
+{
+    return ((int64_t)stock_series_high(series, index) + stock_series_low(series, index) + stock_series_close(series, index)) / 3;
+}
+
+static void add_close(stock_indicators *indicators, const stock_series &series, size_t index, int sign)
+{
+    int64_t close = stock_series_close(series, index);
+    indicators->close_sum += sign * close;
+    indicators->close_square_sum += sign * close * close;
+}
+
+static void add_price_volume(stock_indicators *indicators, const stock_series &series, size_t index, int sign)
+{
+    int64_t volume = stock_series_volume(series, index);
+    indicators->price_volume_sum += sign * typical_price(series, index) * volume;
+    indicators->volume_sum += sign * volume;
+}
+
+// The sums cover the bars before index when called and the bars up to it on return
+static void compute_bar(stock_indicators *indicators, const stock_series &series, size_t index)
+{
+    add_close(indicators, series, index, 1);
+    if (index >= STOCK_SMA_PERIOD)
+    {
+        add_close(indicators, series, index - STOCK_SMA_PERIOD, -1);
+    }
+    add_price_volume(indicators, series, index, 1);
+    if (index >= STOCK_VWAP_PERIOD)
+    {
+        add_price_volume(indicators, series, index - STOCK_VWAP_PERIOD, -1);
+    }
+
+    size_t slot = stock_series_slot(series, index);
+    const int64_t period = STOCK_SMA_PERIOD;
+    if (index + 1 >= STOCK_SMA_PERIOD)
+    {
+        indicators->sma[slot] = rounded_div(indicators->close_sum, period);
+        // sqrt(period * sum(x^2) - sum(x)^2) / period, the square sum keeps it exact in integers
+        int64_t scaled_variance = period * indicators->close_square_sum - indicators->close_sum * indicators->close_sum;
+        indicators->deviation[slot] = isqrt(max(scaled_variance, (int64_t)0)) / period;
+    }
+    else
+    {
+        indicators->sma[slot] = STOCK_INDICATOR_NONE;
+        indicators->deviation[slot] = STOCK_INDICATOR_NONE;
+    }
+    bool has_vwap = index + 1 >= STOCK_VWAP_PERIOD && indicators->volume_sum > 0;
+    indicators->vwap[slot] = has_vwap ? rounded_div(indicators->price_volume_sum, indicators->volume_sum) : STOCK_INDICATOR_NONE;
+
+    // Smoothing 2 / (period + 1), seeded with the oldest close
+    int32_t close = stock_series_close(series, index);
+    if (index == 0)
+    {
+        indicators->ema[slot] = close;
+    }
+    else
+    {
+        int32_t previous = indicators->ema[stock_series_slot(series, index - 1)];
+        indicators->ema[slot] = previous + rounded_div(2 * ((int64_t)close - previous), STOCK_EMA_PERIOD + 1);
+    }
+}
+
+void stock_indicators_clear(stock_indicators *indicators)
+{
+    indicators->next_sequence = 0;
+    indicators->close_sum = 0;
+    indicators->close_square_sum = 0;
+    indicators->price_volume_sum = 0;
+    indicators->volume_sum = 0;
+}
+
+void stock_indicators_append(stock_indicators *indicators, const stock_series &series)
+{
+    if (indicators->next_sequence < oldest_sequence(series))
+    {
+        // The ring overwrote bars that were never computed
+        stock_indicators_recompute_from(indicators, series, 0);
+        return;
+    }
+    while (indicators->next_sequence < series.next_sequence)
+    {
+        compute_bar(indicators, series, indicators->next_sequence - oldest_sequence(series));
+        indicators->next_sequence++;
+    }
+}
+
+void stock_indicators_recompute_from(stock_indicators *indicators, const stock_series &series, size_t index)
+{
+    index = min(index, (size_t)series.count);
+    stock_indicators_clear(indicators);
+    for (size_t i = index - min(index, STOCK_SMA_PERIOD); i < index; i++)
+    {
+        add_close(indicators, series, i, 1);
+    }
+    for (size_t i = index - min(index, STOCK_VWAP_PERIOD); i < index; i++)
+    {
+        add_price_volume(indicators, series, i, 1);
+    }
+    indicators->next_sequence = oldest_sequence(series) + index;
+    stock_indicators_append(indicators, series);
+}
+
+int32_t stock_indicator_value(const stock_indicators &indicators, const stock_series &series, stock_indicator indicator, size_t index)
+{
+    size_t slot = stock_series_slot(series, index);
+    switch (indicator)
+    {
+    case STOCK_INDICATOR_SMA:
+    case STOCK_INDICATOR_BOLLINGER:
+        return indicators.sma[slot];
+    case STOCK_INDICATOR_EMA:
+        return indicators.ema[slot];
+    case STOCK_INDICATOR_VWAP:
+        return indicators.vwap[slot];
+    }
+    return STOCK_INDICATOR_NONE;
+}
+
+int32_t stock_indicator_band(const stock_indicators &indicators, const stock_series &series, size_t index, bool upper)
+{
+    size_t slot = stock_series_slot(series, index);
+    if (indicators.sma[slot] == STOCK_INDICATOR_NONE)
+    {
+        return STOCK_INDICATOR_NONE;
+    }
+    int32_t width = STOCK_BOLLINGER_WIDTH * indicators.deviation[slot];
+    return upper ? indicators.sma[slot] + width : indicators.sma[slot] - width;
+}
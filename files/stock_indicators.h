@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "stock_series.h"
+
+// Overlays of the stock chart, STOCK_CHART_INDICATORS in config.h combines them
+enum stock_indicator
+{
+    STOCK_INDICATOR_SMA = 1 << 0,       // simple moving average of the closes
+    STOCK_INDICATOR_EMA = 1 << 1,       // exponential moving average of the closes
+    STOCK_INDICATOR_BOLLINGER = 1 << 2, // SMA +- 2 standard deviations of the closes
+    STOCK_INDICATOR_VWAP = 1 << 3,      // rolling volume weighted average of the typical price (high + low + close) / 3
+};
+
+const size_t STOCK_SMA_PERIOD = 20; // also the middle and the deviation period of the Bollinger bands
+const size_t STOCK_EMA_PERIOD = 50;
+const size_t STOCK_VWAP_PERIOD = 20; // daily bars have no session, the VWAP rolls over days
+const int32_t STOCK_BOLLINGER_WIDTH = 2;
+const int32_t STOCK_INDICATOR_NONE = INT32_MIN; // before a period of bars is available
+
+// Indicator values per bar in cents, in the ring slots of the series they are computed from, so dropping
+// the oldest bars needs no work. The rolling sums cover the newest bars: an append adds the new bar and
+// removes the one leaving the period, O(1) in integer math whatever the history length
+struct stock_indicators
+{
+    int32_t sma[STOCK_SERIES_CAPACITY];
+    int32_t ema[STOCK_SERIES_CAPACITY];
+    int32_t deviation[STOCK_SERIES_CAPACITY]; // standard deviation over STOCK_SMA_PERIOD closes
+    int32_t vwap[STOCK_SERIES_CAPACITY];
+    uint32_t next_sequence; // sequence number of the next bar of the series to compute
+    int64_t close_sum;
+    int64_t close_square_sum;
+    int64_t price_volume_sum;
+    int64_t volume_sum;
+};
+
+void stock_indicators_clear(stock_indicators *indicators);
+// Computes the bars appended since the last call, O(1) per bar
+void stock_indicators_append(stock_indicators *indicators, const stock_series &series);
+// Recomputes from the bar at index on, after it was replaced or the oldest bars were dropped below a
+// period. O(period + bars after it)
+void stock_indicators_recompute_from(stock_indicators *indicators, const stock_series &series, size_t index);
+// Value of indicator at the bar at index, STOCK_INDICATOR_NONE while it lacks bars. The Bollinger bands
+// are sma +- STOCK_BOLLINGER_WIDTH * deviation, see stock_indicator_band
+int32_t stock_indicator_value(const stock_indicators &indicators, const stock_series &series, stock_indicator indicator, size_t index);
+int32_t stock_indicator_band(const stock_indicators &indicators, const stock_series &series, size_t index, bool upper);
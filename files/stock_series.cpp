@@ -0,0 +1,204 @@
+#include <Arduino.h>
+#include <cmath>
+#include "stock_series.h"
+
+int32_t stock_price_to_fixed(float price)
+{
+    return (int32_t)lroundf(price * STOCK_PRICE_SCALE);
+}
+
+float stock_price_from_fixed(int32_t price)
+{
+    return (float)price / STOCK_PRICE_SCALE;
+}
+
+static stock_pyramid_node &pyramid_node(stock_series *series, int level, uint32_t node)
+{
+    return series->pyramid[stock_pyramid_level_offset(level) + node % stock_pyramid_level_size(level)];
+}
+
+static const stock_pyramid_node &pyramid_node(const stock_series &series, int level, uint32_t node)
+{
+    return series.pyramid[stock_pyramid_level_offset(level) + node % stock_pyramid_level_size(level)];
+}
+
+static int pyramid_shift(int level)
+{
+    return STOCK_PYRAMID_BASE_SHIFT + level;
+}
+
+static uint32_t sequence_of(const stock_series &series, size_t index)
+{
+    return series.next_sequence - series.count + index;
+}
+
+static stock_pyramid_node bar_node(const stock_series &series, size_t index)
+{
+    size_t slot = stock_series_slot(series, index);
+    return {series.low[slot], series.high[slot]};
+}
+
+static void write_bar(stock_series *series, size_t slot, const stock_fixed_bar &bar)
+{
+    series->open[slot] = bar.open;
+    series->close[slot] = bar.close;
+    series->high[slot] = max(bar.high, max(bar.open, bar.close));
+    series->low[slot] = bar.low > 0 ? min(bar.low, min(bar.open, bar.close)) : min(bar.open, bar.close);
+    series->volume[slot] = bar.volume;
+}
+
+static void merge_node(stock_pyramid_node *into, const stock_pyramid_node &node)
+{
+    into->min = min(into->min, node.min);
+    into->max = max(into->max, node.max);
+}
+
+// Only the bars still in the series are merged, a node that lost bars to the ring is never queried
+static void rebuild_pyramid_path(stock_series *series, size_t index)
+{
+    uint32_t sequence = sequence_of(*series, index);
+    uint32_t oldest = sequence_of(*series, 0);
+    for (int level = 0; level < STOCK_PYRAMID_LEVELS; level++)
+    {
+        uint32_t node = sequence >> pyramid_shift(level);
+        uint32_t node_start = node << pyramid_shift(level);
+        uint32_t node_end = min(node_start + (1u << pyramid_shift(level)), series->next_sequence);
+        stock_pyramid_node rebuilt = {INT32_MAX, INT32_MIN};
+        if (level == 0)
+        {
+            for (uint32_t s = max(node_start, oldest); s < node_end; s++)
+            {
+                merge_node(&rebuilt, bar_node(*series, s - oldest));
+            }
+        }
+        else
+        {
+            uint32_t half = 1u << pyramid_shift(level - 1);
+            merge_node(&rebuilt, pyramid_node(series, level - 1, node * 2));
+            if (node_start + half < node_end)
+            {
+                merge_node(&rebuilt, pyramid_node(series, level - 1, node * 2 + 1));
+            }
+        }
+        pyramid_node(series, level, node) = rebuilt;
+    }
+}
+
+void stock_series_clear(stock_series *series)
+{
+    series->first = 0;
+    series->count = 0;
+    series->next_sequence = 0;
+    series->revision++;
+}
+
+void stock_series_append(stock_series *series, const stock_fixed_bar &bar)
+{
+    size_t slot;
+    if (series->count == STOCK_SERIES_CAPACITY)
+    {
+        slot = series->first;
+        series->first = (series->first + 1) % STOCK_SERIES_CAPACITY;
+    }
+    else
+    {
+        slot = stock_series_slot(*series, series->count++);
+    }
+    series->epoch_day[slot] = bar.epoch_day;
+    write_bar(series, slot, bar);
+    series->revision++;
+
+    uint32_t sequence = series->next_sequence++;
+    stock_pyramid_node bar_range = {series->low[slot], series->high[slot]};
+    for (int level = 0; level < STOCK_PYRAMID_LEVELS; level++)
+    {
+        uint32_t node = sequence >> pyramid_shift(level);
+        bool starts_node = (sequence & ((1u << pyramid_shift(level)) - 1)) == 0;
+        if (starts_node)
+        {
+            pyramid_node(series, level, node) = bar_range;
+        }
+        else
+        {
+            merge_node(&pyramid_node(series, level, node), bar_range);
+        }
+    }
+}
+
+void stock_series_set(stock_series *series, size_t index, const stock_fixed_bar &bar)
+{
+    size_t slot = stock_series_slot(*series, index);
+    write_bar(series, slot, bar);
+    series->revision++;
+    rebuild_pyramid_path(series, index);
+}
+
+void stock_series_drop_oldest(stock_series *series, size_t count)
+{
+    count = min(count, (size_t)series->count);
+    series->first = (series->first + count) % STOCK_SERIES_CAPACITY;
+    series->count -= count;
+    series->revision++;
+}
+
+stock_fixed_bar stock_series_bar(const stock_series &series, size_t index)
+{
+    size_t slot = stock_series_slot(series, index);
+    return {series.epoch_day[slot], series.open[slot], series.close[slot], series.high[slot], series.low[slot], series.volume[slot]};
+}
+
+size_t stock_series_lower_bound(const stock_series &series, uint16_t epoch_day)
+{
+    size_t low = 0;
+    size_t high = series.count;
+    while (low < high)
+    {
+        size_t middle = (low + high) / 2;
+        if (stock_series_day(series, middle) < epoch_day)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+stock_series_stats stock_series_window_stats(const stock_series &series, size_t first, size_t count)
+{
+    stock_series_stats stats = {};
+    if (count == 0)
+    {
+        return stats;
+    }
+
+    // The window is covered by the largest aligned nodes that fit, single bars at the unaligned ends
+    stock_pyramid_node range = {INT32_MAX, INT32_MIN};
+    uint32_t oldest = sequence_of(series, 0);
+    uint32_t sequence = sequence_of(series, first);
+    uint32_t end = sequence + count;
+    while (sequence < end)
+    {
+        int level = STOCK_PYRAMID_LEVELS - 1;
+        while (level >= 0 && ((sequence & ((1u << pyramid_shift(level)) - 1)) != 0 || sequence + (1u << pyramid_shift(level)) > end))
+        {
+            level--;
+        }
+        if (level < 0)
+        {
+            merge_node(&range, bar_node(series, sequence - oldest));
+            sequence++;
+            continue;
+        }
+        merge_node(&range, pyramid_node(series, level, sequence >> pyramid_shift(level)));
+        sequence += 1u << pyramid_shift(level);
+    }
+
+    stats.min = range.min;
+    stats.max = range.max;
+    stats.first_close = stock_series_close(series, first);
+    stats.last_close = stock_series_close(series, first + count - 1);
+    return stats;
+}
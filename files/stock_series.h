@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "config.h"
+
+const size_t STOCK_SERIES_CAPACITY = STOCK_HISTORY_DAYS; // at most one bar per calendar day
+// Prices are stored in cents, the tick size of stocks above a dollar. int32 holds up to about $21M
+const int32_t STOCK_PRICE_SCALE = 100;
+
+// Low/high pyramid over the bars: level 0 nodes cover 4 bars, every level above twice as many. Nodes are
+// aligned to the sequence number of their first bar, so appending touches one node per level
+const int STOCK_PYRAMID_BASE_SHIFT = 2;
+const int STOCK_PYRAMID_LEVELS = 9; // the top level nodes cover 1024 bars
+
+struct stock_pyramid_node
+{
+    int32_t min;
+    int32_t max;
+};
+
+// Each level is a ring too, 2 spare nodes for the partly covered ones at both ends of the series
+constexpr size_t stock_pyramid_level_size(int level)
+{
+    return (STOCK_SERIES_CAPACITY >> (STOCK_PYRAMID_BASE_SHIFT + level)) + 2;
+}
+constexpr size_t stock_pyramid_level_offset(int level)
+{
+    return level == 0 ? 0 : stock_pyramid_level_offset(level - 1) + stock_pyramid_level_size(level - 1);
+}
+const size_t STOCK_PYRAMID_NODES = stock_pyramid_level_offset(STOCK_PYRAMID_LEVELS);
+
+// One bar in the units of the series
+struct stock_fixed_bar
+{
+    uint16_t epoch_day;
+    int32_t open;
+    int32_t close;
+    int32_t high; // widened to cover open and close, apis leave it 0 for some bars
+    int32_t low;
+    uint32_t volume;
+};
+
+// Daily bars as columns in one fixed capacity ring, 22 bytes per bar and no heap. Appending overwrites
+// the oldest bar once full, trimming only moves the start, both O(1)
+struct stock_series
+{
+    uint16_t epoch_day[STOCK_SERIES_CAPACITY];
+    int32_t open[STOCK_SERIES_CAPACITY];
+    int32_t close[STOCK_SERIES_CAPACITY];
+    int32_t high[STOCK_SERIES_CAPACITY];
+    int32_t low[STOCK_SERIES_CAPACITY];
+    uint32_t volume[STOCK_SERIES_CAPACITY];
+    stock_pyramid_node pyramid[STOCK_PYRAMID_NODES];
+    uint16_t first; // ring slot of the oldest bar
+    uint16_t count;
+    uint32_t next_sequence; // sequence number of the next bar appended, the newest bar has next_sequence - 1
+    uint32_t revision;      // bumped by every change, views compare it to skip redrawing unchanged data
+};
+
+// Lowest low and highest high of a window, and its first and last close
+struct stock_series_stats
+{
+    int32_t min;
+    int32_t max;
+    int32_t first_close;
+    int32_t last_close;
+};
+
+int32_t stock_price_to_fixed(float price);
+float stock_price_from_fixed(int32_t price);
+
+// Ring slot of the bar at index, index 0 is the oldest bar
+inline size_t stock_series_slot(const stock_series &series, size_t index)
+{
+    return (series.first + index) % STOCK_SERIES_CAPACITY;
+}
+inline uint16_t stock_series_day(const stock_series &series, size_t index) { return series.epoch_day[stock_series_slot(series, index)]; }
+inline int32_t stock_series_open(const stock_series &series, size_t index) { return series.open[stock_series_slot(series, index)]; }
+inline int32_t stock_series_close(const stock_series &series, size_t index) { return series.close[stock_series_slot(series, index)]; }
+inline int32_t stock_series_high(const stock_series &series, size_t index) { return series.high[stock_series_slot(series, index)]; }
+inline int32_t stock_series_low(const stock_series &series, size_t index) { return series.low[stock_series_slot(series, index)]; }
+inline uint32_t stock_series_volume(const stock_series &series, size_t index) { return series.volume[stock_series_slot(series, index)]; }
+
+void stock_series_clear(stock_series *series);
+void stock_series_append(stock_series *series, const stock_fixed_bar &bar);
+// Replaces the bar at index, its day is kept
+void stock_series_set(stock_series *series, size_t index, const stock_fixed_bar &bar);
+stock_fixed_bar stock_series_bar(const stock_series &series, size_t index);
+void stock_series_drop_oldest(stock_series *series, size_t count);
+// Index of the first bar on or after epoch_day, count when there is none
+size_t stock_series_lower_bound(const stock_series &series, uint16_t epoch_day);
+// O(log n) through the pyramid, whatever the window length
+stock_series_stats stock_series_window_stats(const stock_series &series, size_t first, size_t count);
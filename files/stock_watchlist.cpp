@@ -0,0 +1,185 @@
+#include <Arduino.h>
+#include <algorithm>
+#include <esp_heap_caps.h>
+#include "stock_watchlist.h"
+#include "config.h"
+
+static stock_watchlist_entry *watchlist_entries = nullptr;
+static size_t watchlist_size = 0;
+static size_t watchlist_cursor = 0; // next entry of the round robin
+
+static std::vector<std::string> parse_tickers(const char *tickers)
+{
+    std::vector<std::string> parsed;
+    std::string ticker;
+    for (const char *c = tickers;; c++)
+    {
+        if (*c != ',' && *c != '\0')
+        {
+            if (*c != ' ')
+            {
+                ticker += toupper(*c);
+            }
+            continue;
+        }
+        if (ticker.size() > STOCK_TICKER_MAX_LENGTH)
+        {
+            Serial.printf("Skipping ticker %s, longer than %u characters\n", ticker.c_str(), STOCK_TICKER_MAX_LENGTH);
+        }
+        else if (!ticker.empty() && parsed.size() == STOCK_WATCHLIST_MAX)
+        {
+            Serial.printf("Skipping ticker %s, the watchlist holds %u\n", ticker.c_str(), STOCK_WATCHLIST_MAX);
+        }
+        else if (!ticker.empty() && std::find(parsed.begin(), parsed.end(), ticker) == parsed.end())
+        {
+            parsed.push_back(ticker);
+        }
+        ticker.clear();
+        if (*c == '\0')
+        {
+            return parsed;
+        }
+    }
+}
+
+static void reset_entry(stock_watchlist_entry *entry, const std::string &ticker, bool load_cache)
+{
+    stock_history_init(&entry->history, ticker);
+    if (load_cache)
+    {
+        stock_history_load(&entry->history);
+    }
+    entry->quote = {};
+    entry->history_fetched_at = 0;
+    entry->state = entry->history.series.count > 0 ? STOCK_DATA_STALE : STOCK_DATA_LOADING;
+}
+
+bool stock_watchlist_begin(const char *tickers)
+{
+    std::vector<std::string> parsed = parse_tickers(tickers);
+    if (parsed.empty())
+    {
+        Serial.println("Stock watchlist is empty");
+        return false;
+    }
+
+    // One allocation for the whole list, its size only depends on the number of tickers
+    size_t bytes = parsed.size() * sizeof(stock_watchlist_entry);
+    watchlist_entries = (stock_watchlist_entry *)heap_caps_calloc(parsed.size(), sizeof(stock_watchlist_entry), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (watchlist_entries == nullptr)
+    {
+        watchlist_entries = (stock_watchlist_entry *)calloc(parsed.size(), sizeof(stock_watchlist_entry));
+    }
+    if (watchlist_entries == nullptr)
+    {
+        Serial.printf("Stock watchlist: allocating %u bytes failed\n", bytes);
+        return false;
+    }
+    watchlist_size = parsed.size();
+    stock_history_erase_nvs_caches();
+
+    for (size_t i = 0; i < watchlist_size; i++)
+    {
+        reset_entry(&watchlist_entries[i], parsed[i], true);
+    }
+    Serial.printf("Stock watchlist: %u tickers, %u bytes\n", watchlist_size, bytes);
+    return true;
+}
+
+void stock_watchlist_reset(bool load_cache)
+{
+    for (size_t i = 0; i < watchlist_size; i++)
+    {
+        std::string ticker = watchlist_entries[i].history.ticker;
+        reset_entry(&watchlist_entries[i], ticker, load_cache);
+    }
+    watchlist_cursor = 0;
+}
+
+size_t stock_watchlist_size(void)
+{
+    return watchlist_size;
+}
+
+stock_watchlist_entry *stock_watchlist_entry_at(size_t index)
+{
+    return index < watchlist_size ? &watchlist_entries[index] : nullptr;
+}
+
+std::vector<std::string> stock_watchlist_tickers(void)
+{
+    std::vector<std::string> tickers;
+    for (size_t i = 0; i < watchlist_size; i++)
+    {
+        tickers.push_back(watchlist_entries[i].history.ticker);
+    }
+    return tickers;
+}
+
+int stock_watchlist_next_stale_history(size_t preferred, time_t stale_before)
+{
+    if (preferred < watchlist_size && watchlist_entries[preferred].history_fetched_at < stale_before)
+    {
+        return preferred;
+    }
+    for (size_t i = 0; i < watchlist_size; i++)
+    {
+        size_t index = (watchlist_cursor + i) % watchlist_size;
+        if (watchlist_entries[index].history_fetched_at < stale_before)
+        {
+            watchlist_cursor = (index + 1) % watchlist_size;
+            return index;
+        }
+    }
+    return -1;
+}
+
+void stock_watchlist_record_fetch(stock_watchlist_entry *entry, bool succeeded)
+{
+    stock_data_state state = entry->state;
+    if (entry->history.series.count > 0)
+    {
+        state = succeeded ? STOCK_DATA_READY : STOCK_DATA_STALE;
+    }
+    else if (!succeeded || entry->history_fetched_at != 0)
+    {
+        state = STOCK_DATA_ERROR;
+    }
+    if (state != entry->state)
+    {
+        Serial.printf("Stock %s: %s -> %s\n", entry->history.ticker, stock_data_state_str(entry->state), stock_data_state_str(state));
+        entry->state = state;
+    }
+}
+
+bool stock_watchlist_age(time_t stale_before)
+{
+    bool aged = false;
+    for (size_t i = 0; i < watchlist_size; i++)
+    {
+        stock_watchlist_entry *entry = &watchlist_entries[i];
+        if (entry->state == STOCK_DATA_READY && max(entry->history_fetched_at, entry->quote.updated_at) < stale_before)
+        {
+            Serial.printf("Stock %s: ready -> stale\n", entry->history.ticker);
+            entry->state = STOCK_DATA_STALE;
+            aged = true;
+        }
+    }
+    return aged;
+}
+
+const char *stock_data_state_str(stock_data_state state)
+{
+    switch (state)
+    {
+    case STOCK_DATA_LOADING:
+        return "loading";
+    case STOCK_DATA_READY:
+        return "ready";
+    case STOCK_DATA_STALE:
+        return "stale";
+    case STOCK_DATA_ERROR:
+        return "error";
+    }
+    return "unknown";
+}
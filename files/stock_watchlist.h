@@ -0,0 +1,51 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <ctime>
+#include "stock_history.h"
+
+enum stock_data_state
+{
+    STOCK_DATA_LOADING, // nothing to show yet, the first fetch is pending
+    STOCK_DATA_READY,   // fetched within its refresh interval
+    STOCK_DATA_STALE,   // shows older data: the flash cache, a failed refresh or a missed one
+    STOCK_DATA_ERROR,   // nothing to show, the fetch failed or the api has no bars for the ticker
+};
+
+struct stock_quote
+{
+    float price;
+    float change; // since the previous close
+    float percent_change;
+    uint16_t epoch_day; // trading day of the price, 0 when the api does not tell
+    time_t updated_at;  // 0 until the first quote arrives
+};
+
+struct stock_watchlist_entry
+{
+    stock_history history;
+    stock_quote quote;
+    time_t history_fetched_at; // 0 while only the flash cache is known
+    stock_data_state state;
+};
+
+// Parses the comma separated tickers, allocates every entry up front and loads their caches. Tickers past
+// STOCK_WATCHLIST_MAX or longer than STOCK_TICKER_MAX_LENGTH are skipped
+bool stock_watchlist_begin(const char *tickers);
+// Forgets every quote and fetched history, the entries start over from their flash cache or empty
+void stock_watchlist_reset(bool load_cache);
+size_t stock_watchlist_size(void);
+// Entries are written by the stock refresh task with the lvgl lock held and read by lvgl
+stock_watchlist_entry *stock_watchlist_entry_at(size_t index);
+std::vector<std::string> stock_watchlist_tickers(void);
+// Round robin over the entries whose history was not fetched since stale_before, starting at preferred
+// when that one is stale. -1 when every history is fresh
+int stock_watchlist_next_stale_history(size_t preferred, time_t stale_before);
+// Moves the entry to ready or stale after a fetch of its quote or history, depending on whether it has bars
+// to show, and to error when it has none. A quote alone leaves an entry without bars loading
+void stock_watchlist_record_fetch(stock_watchlist_entry *entry, bool succeeded);
+// Ready entries not fetched since stale_before turn stale, true when any did
+bool stock_watchlist_age(time_t stale_before);
+const char *stock_data_state_str(stock_data_state state);
@@ -1,18 +1,22 @@
 #include <lvgl.h>
 #include <WiFi.h>
 #include "time.h"
-#include <HTTPClient.h>
-#include <ArduinoJson.h>
+#include <algorithm>
+#include <tuple>
+#include <esp_heap_caps.h>
 #include "stock_widget.h"
 #include "config.h"
 #include "utils.h"
-
-struct stock_month_chart_data_item
-{
-  std::string date;
-  float open_price;
-  float close_price;
-};
+#include "widget_state_store.h"
+#include "stock_history.h"
+#include "stock_watchlist.h"
+#include "stock_data_source.h"
+#include "market_calendar.h"
+#include "chart_downsample.h"
+#include "connectivity.h"
+#include "radio_power.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
 
 struct widget_data
 {
@@ -21,10 +25,19 @@ struct widget_data
   float price;
   float percent_change;
   float dollar_change;
-  std::vector<stock_month_chart_data_item> month_chart_data;
-  std::vector<int32_t> display_chart_data;
+  // Chart window of the shown entry's series, which the refresh task only writes with the lvgl lock held
+  const stock_series *series = nullptr;
+  const stock_indicators *indicators = nullptr;
+  size_t chart_first = 0;
+  size_t chart_count = 0;
+  stock_series_stats chart_stats; // includes the live point
+  // A quote of the last bar's day or newer ends the line: it replaces the close of that day or adds a new day
+  bool has_live_point = false;
+  int32_t live_point_value = 0;
+  uint16_t live_point_day = 0;
   bool price_positive;
-  bool is_loading = false;
+  stock_data_state state = STOCK_DATA_LOADING;
+  time_t updated_at = 0; // of the data shown, the flash cache until the first fetch
 };
 
 widget_data stock_widget_data;
@@ -34,119 +47,572 @@ lv_obj_t *latest_price_label;
 lv_obj_t *percent_change_label;
 lv_obj_t *dollar_change_label;
 lv_obj_t *chart;
+lv_chart_series_t *chart_series;
+lv_obj_t *candle_canvas; // replaces the chart while candles are drawn
 lv_obj_t *stock_ticker_arrow_label;
 lv_obj_t *stock_ticker_label;
 lv_obj_t *company_name_label;
+lv_obj_t *data_age_label;
+lv_obj_t *watchlist_page_label;
+lv_obj_t *chart_range_buttons;
+lv_obj_t *chart_scrub_area; // over the line and the candles, takes the touches of the chart
+lv_obj_t *crosshair_vertical;
+lv_obj_t *crosshair_horizontal;
+lv_obj_t *crosshair_label;
+static lv_timer_t *stock_watchlist_cycle_timer = NULL;
+static TaskHandle_t stock_watchlist_task = NULL;
+static size_t stock_widget_shown = 0; // watchlist index on screen
+static const stock_data_source *stock_source = nullptr;
+static const stock_data_source *volatile stock_source_requested = nullptr; // switched to by the refresh task
+static time_t stock_quotes_fetched_at = 0; // of the last successful batch
+
+const int STOCK_CHART_WIDTH = 200;
+const int STOCK_CHART_HEIGHT = 68;
+const size_t STOCK_CHART_CANDIDATES = STOCK_CHART_WIDTH * 2; // points LTTB picks the chart points from
+static uint16_t stock_chart_points[STOCK_CHART_WIDTH];        // candidate indices picked for the chart, one per pixel at most
+static int32_t stock_chart_candidates[STOCK_CHART_CANDIDATES];
+// What the chart shows now, a live quote that keeps these only moves the last point
+static int32_t stock_chart_drawn_min = 0;
+static int32_t stock_chart_drawn_max = 0;
+
+// The day and price of every drawn point or candle from left to right, so a touch maps to one in O(1)
+struct stock_chart_drawn_point
+{
+  uint16_t day;
+  int32_t price;
+};
+static stock_chart_drawn_point stock_chart_drawn_points[STOCK_CHART_WIDTH];
+static size_t stock_chart_drawn_point_count = 0;
+static bool stock_chart_drawn_bucketed = false; // line points are bucket lows and highs, not closes
+static int32_t chart_scrub_pressed_x = 0;
+static bool is_chart_scrubbed = false;    // moved further than a tap since pressed
+const int STOCK_CHART_SCRUB_TAP_SLOP = 6; // px a tap may move
+const int STOCK_CROSSHAIR_LABEL_WIDTH = 128;
+const int STOCK_CROSSHAIR_LABEL_HEIGHT = 18;
+
+// Candles are rasterized into a canvas once per data change, every frame after that is a blit of it
+const int STOCK_CANDLE_PITCH = 4;       // at least a 3 px body and a 1 px gap per candle
+const int STOCK_CANDLE_MAX_BODY_WIDTH = 9;
+const size_t STOCK_CANDLE_MAX = STOCK_CHART_WIDTH / STOCK_CANDLE_PITCH; // longer windows merge bars into one candle
+const int STOCK_CHART_BENCH_RUNS = 20;
+
+struct stock_candle
+{
+  int32_t open;
+  int32_t close;
+  int32_t high;
+  int32_t low;
+  uint16_t day; // of its last bar
+};
+static stock_candle stock_candles[STOCK_CANDLE_MAX];
+static uint8_t *candle_canvas_buffer = nullptr; // in psram
+static bool stock_chart_candles = STOCK_CHART_CANDLES;
 
-const std::string STOCK_TICKER = "TSLA";
-const bool DEBUG_API_REQUESTS = true;
+// Everything the chart is drawn from, an unchanged key skips the redraw
+struct stock_chart_key
+{
+  const stock_series *series;
+  uint32_t revision;
+  size_t first;
+  size_t count;
+  bool has_live_point;
+  int32_t live_point_value;
+  uint16_t live_point_day;
+  bool candles;
+};
+static stock_chart_key stock_chart_drawn_key = {};
 
-std::string get_month_ago_utc_time_str(void)
+// Indicator lines over the chart, the Bollinger bands take two. Their chart series are added once
+struct stock_overlay
 {
-  time_t timeinfo;
-  time(&timeinfo);
+  stock_indicator indicator;
+  int band; // 1 for the upper, -1 for the lower Bollinger band
+  lv_palette_t palette;
+  lv_chart_series_t *chart_series;
+};
+static stock_overlay stock_overlays[] = {
+    {STOCK_INDICATOR_BOLLINGER, 1, LV_PALETTE_BLUE_GREY, nullptr},
+    {STOCK_INDICATOR_BOLLINGER, -1, LV_PALETTE_BLUE_GREY, nullptr},
+    {STOCK_INDICATOR_SMA, 0, LV_PALETTE_AMBER, nullptr},
+    {STOCK_INDICATOR_EMA, 0, LV_PALETTE_CYAN, nullptr},
+    {STOCK_INDICATOR_VWAP, 0, LV_PALETTE_PURPLE, nullptr},
+};
 
-  time_t current_time = timeinfo;
-  current_time -= 30 * 24 * 60 * 60;
-  char time_str[30];
-  strftime(time_str, sizeof(time_str), "%Y-%m-%d", gmtime(&current_time));
-  return std::string(time_str);
+static bool is_stock_overlay_shown(const stock_overlay &overlay)
+{
+  return (STOCK_CHART_INDICATORS & overlay.indicator) != 0;
 }
 
-std::pair<bool, JsonDocument> send_http_request_stock(const std::string serverEndpoint, const std::string http_method, const std::string payload="")
+static int32_t stock_overlay_value(const stock_overlay &overlay, size_t bar)
 {
-  return send_http_request(serverEndpoint, http_method, payload,{}, DEBUG_API_REQUESTS);
+  const stock_series &series = *stock_widget_data.series;
+  const stock_indicators &indicators = *stock_widget_data.indicators;
+  if (overlay.band != 0)
+  {
+    return stock_indicator_band(indicators, series, bar, overlay.band > 0);
+  }
+  return stock_indicator_value(indicators, series, overlay.indicator, bar);
 }
+static bool is_stock_chart_drawn = false;
+static uint32_t stock_chart_redraws = 0;
+static uint32_t stock_chart_skipped_redraws = 0;
 
-std::pair<bool, std::vector<stock_month_chart_data_item>> request_stock_info(void)
+// Calendar days shown in the chart for each range button, the cached history reaches back the longest
+const int STOCK_CHART_RANGE_DAYS[] = {7, 30, 91, 365, 1826};
+static const char *stock_chart_range_map[] = {"1W", "1M", "3M", "1Y", "5Y", ""};
+static size_t stock_chart_range = 1;
+const int REFRESH_STOCK_WIDGET_DATA_AGE_FREQ_MS = 30000;
+const uint32_t REFRESH_STOCK_QUOTES_FREQ_MS = 15 * 60 * 1000; // one batched request for the whole watchlist, scaled by the radio power profile
+const uint32_t REFRESH_STOCK_QUOTES_RETRY_MS = 60 * 1000;
+const int STOCK_DATA_STALE_AFTER_INTERVALS = 2; // quote intervals without a fetch before ready data turns stale
+const time_t STOCK_HISTORY_MAX_AGE_S = 6 * 60 * 60;      // without STOCK_MARKET_HOURS
+const time_t STOCK_CLOSE_SETTLE_S = 30 * 60;             // after the close until the apis have the final daily bar
+const uint32_t STOCK_MARKET_RECHECK_MS = 60 * 60 * 1000; // the idle task rechecks the clock this often, without the radio
+const int STOCK_HISTORY_REFRESHES_PER_TICK = 2;          // histories fetched per round robin step
+const uint32_t STOCK_HISTORY_ROUND_ROBIN_FREQ_MS = 5000; // between steps while some history is stale
+const char *STOCK_REFRESH_RADIO_JOB = "StockWatchlist";
+
+// Without any bars only the ticker is set, the widget then shows it as loading. The window ends at the newest
+// cached bar rather than today, so a cache older than the range or a clock that is not set yet still shows
+bool set_stock_widget_data(const stock_watchlist_entry &entry)
 {
-  std::string time_str = get_month_ago_utc_time_str();
-  if (DEBUG_API_REQUESTS)
+  const stock_series &series = entry.history.series;
+  int32_t newest_day = series.count > 0 ? stock_series_day(series, series.count - 1) : 0;
+  size_t chart_first = stock_series_lower_bound(series, max(newest_day - STOCK_CHART_RANGE_DAYS[stock_chart_range], (int32_t)0));
+  stock_widget_data.stock_ticker = entry.history.ticker;
+  stock_widget_data.company_name = entry.history.name;
+  stock_widget_data.state = entry.state;
+  bool is_fetched = entry.history_fetched_at != 0 || entry.quote.updated_at != 0;
+  stock_widget_data.updated_at = is_fetched ? max(entry.history_fetched_at, entry.quote.updated_at) : entry.history.saved_at;
+  stock_widget_data.series = &series;
+  stock_widget_data.indicators = &entry.history.indicators;
+  stock_widget_data.chart_first = chart_first;
+  stock_widget_data.chart_count = series.count - chart_first;
+  stock_widget_data.chart_stats = stock_series_window_stats(series, chart_first, stock_widget_data.chart_count);
+  stock_widget_data.has_live_point = false;
+  if (stock_widget_data.chart_count == 0)
+  {
+    return false;
+  }
+
+  uint16_t last_day = stock_series_day(series, series.count - 1);
+  uint16_t quote_day = entry.quote.epoch_day != 0 ? entry.quote.epoch_day : last_day;
+  if (entry.quote.updated_at != 0 && quote_day >= last_day)
   {
-    Serial.printf("Time: %s\n", time_str.c_str());
+    stock_widget_data.has_live_point = true;
+    stock_widget_data.live_point_value = stock_price_to_fixed(entry.quote.price);
+    stock_widget_data.live_point_day = quote_day;
+    stock_widget_data.chart_stats.min = min(stock_widget_data.chart_stats.min, stock_widget_data.live_point_value);
+    stock_widget_data.chart_stats.max = max(stock_widget_data.chart_stats.max, stock_widget_data.live_point_value);
   }
 
-  std::string serverEndpoint = (String("https://financialmodelingprep.com/stable/historical-price-eod/full?") +
-                                "symbol=" + String(STOCK_TICKER.c_str()) + "&apikey=" + String(STOCK_API_KEY) + "&from=" + String(time_str.c_str()))
-                                   .c_str();
+  // The quote is newer than the last daily bar
+  float latest_price = entry.quote.updated_at != 0 ? entry.quote.price : stock_price_from_fixed(stock_widget_data.chart_stats.last_close);
+  float previous_close_price = stock_price_from_fixed(stock_widget_data.chart_stats.first_close);
 
-  auto [doc_valid, doc] = send_http_request_stock(serverEndpoint, "GET");
+  stock_widget_data.price = latest_price;
+  stock_widget_data.dollar_change = latest_price - previous_close_price;
+  stock_widget_data.percent_change = ((previous_close_price != 0.0f) ? (stock_widget_data.dollar_change / previous_close_price) * 100.0f : 0.0f);
+  stock_widget_data.price_positive = (latest_price >= previous_close_price);
+  return true;
+}
+
+// The line runs through the open and the close of every bar, point 2 * i is the open of bar i of the window
+static int32_t stock_chart_point_value(const void *context, size_t point)
+{
+  const stock_series &series = *(const stock_series *)context;
+  size_t index = stock_widget_data.chart_first + point / 2;
+  return point % 2 == 0 ? stock_series_open(series, index) : stock_series_close(series, index);
+}
+
+static int32_t stock_chart_candidate_value(const void *context, size_t point)
+{
+  return ((const int32_t *)context)[point];
+}
 
-  if (!doc_valid)
+// Splits a window too long to scan into one bucket per pixel and takes the min and the max of each from the
+// pyramid, ordered by the direction of the bucket. O(pixel width * log n) whatever the window length
+static void select_stock_chart_candidates(void)
+{
+  const stock_series &series = *stock_widget_data.series;
+  size_t first = stock_widget_data.chart_first;
+  size_t count = stock_widget_data.chart_count;
+  for (size_t bucket = 0; bucket < STOCK_CHART_WIDTH; bucket++)
   {
-    return {false, {}};
+    size_t bucket_first = first + bucket * count / STOCK_CHART_WIDTH;
+    size_t bucket_end = first + (bucket + 1) * count / STOCK_CHART_WIDTH;
+    stock_series_stats stats = stock_series_window_stats(series, bucket_first, bucket_end - bucket_first);
+    bool rising = stats.last_close >= stock_series_open(series, bucket_first);
+    stock_chart_candidates[bucket * 2] = rising ? stats.min : stats.max;
+    stock_chart_candidates[bucket * 2 + 1] = rising ? stats.max : stats.min;
   }
+}
+
+static bool is_live_point_appended(void)
+{
+  const stock_series &series = *stock_widget_data.series;
+  return stock_widget_data.has_live_point && stock_widget_data.live_point_day > stock_series_day(series, series.count - 1);
+}
 
-  std::vector<stock_month_chart_data_item> items;
-  for (JsonObject entry : doc.as<JsonArray>())
+// Bar a line chart candidate stands for: its own bar, or the last bar of its pixel bucket
+static size_t stock_chart_candidate_bar(size_t candidate, bool is_bucketed)
+{
+  size_t first = stock_widget_data.chart_first;
+  if (!is_bucketed)
   {
-    items.push_back({
-        .date = entry["date"] ? (std::string)entry["date"].as<std::string>() : "",
-        .open_price = entry["open"] ? entry["open"].as<float>() : 0.0f,
-        .close_price = entry["close"] ? entry["close"].as<float>() : 0.0f,
-    });
+    return first + candidate / 2;
   }
-  return {true, items};
+  return first + (candidate / 2 + 1) * stock_widget_data.chart_count / STOCK_CHART_WIDTH - 1;
 }
 
-std::pair<bool, std::vector<stock_month_chart_data_item>> request_stock_info_dummy(void)
+// The overlays get the indicator values at the bars of the points LTTB picked for the price
+static void render_stock_chart_line_overlays(size_t point_count, bool is_bucketed, bool append_live_point)
 {
-  if (DEBUG_API_REQUESTS)
+  const stock_series &series = *stock_widget_data.series;
+  for (stock_overlay &overlay : stock_overlays)
   {
-    Serial.println("request_stock_info_dummy");
+    if (overlay.chart_series == nullptr)
+    {
+      continue;
+    }
+    if (point_count == 0)
+    {
+      lv_chart_set_all_value(chart, overlay.chart_series, LV_CHART_POINT_NONE);
+      continue;
+    }
+    for (size_t i = 0; i < point_count + append_live_point; i++)
+    {
+      size_t bar = i < point_count ? stock_chart_candidate_bar(stock_chart_points[i], is_bucketed) : series.count - 1;
+      int32_t value = stock_overlay_value(overlay, bar);
+      lv_chart_set_next_value(chart, overlay.chart_series, value == STOCK_INDICATOR_NONE ? LV_CHART_POINT_NONE : value);
+    }
+  }
+}
+
+// Prices go to the chart in cents, so the y range keeps full precision. LTTB picks at most one point per
+// pixel, from the open and close of every bar when there are few enough, otherwise from the min/max
+// candidates, so any range costs the same to draw. The live quote is the last point
+static void render_stock_chart_line(void)
+{
+  const stock_series &series = *stock_widget_data.series;
+  bool append_live_point = stock_widget_data.chart_count > 0 && is_live_point_appended();
+  chart_point_value_fn value = stock_chart_point_value;
+  const void *context = stock_widget_data.series;
+  size_t candidate_count = stock_widget_data.chart_count * 2;
+  bool is_bucketed = candidate_count > STOCK_CHART_CANDIDATES;
+  if (is_bucketed)
+  {
+    select_stock_chart_candidates();
+    value = stock_chart_candidate_value;
+    context = stock_chart_candidates;
+    candidate_count = STOCK_CHART_CANDIDATES;
+  }
+  size_t point_count = lttb_downsample(candidate_count, STOCK_CHART_WIDTH - append_live_point, value, context, stock_chart_points);
+  lv_chart_set_point_count(chart, point_count + append_live_point);
+  render_stock_chart_line_overlays(point_count, is_bucketed, append_live_point);
+  stock_chart_drawn_point_count = 0;
+  stock_chart_drawn_bucketed = is_bucketed;
+  if (point_count == 0)
+  {
+    lv_chart_set_all_value(chart, chart_series, LV_CHART_POINT_NONE);
+    return;
   }
-  std::string dummy_json_str = "[{\"symbol\":\"TSLA\",\"date\":\"2025-10-01\",\"open\":443.8,\"high\":462.29,\"low\":440.75,\"close\":459.46,\"volume\":97498810,\"change\":15.66,\"changePercent\":3.53,\"vwap\":451.575},{\"symbol\":\"TSLA\",\"date\":\"2025-09-30\",\"open\":441.52,\"high\":445,\"low\":433.12,\"close\":444.72,\"volume\":74358000,\"change\":3.2,\"changePercent\":0.72477,\"vwap\":441.09},{\"symbol\":\"TSLA\",\"date\":\"2025-09-29\",\"open\":444.35,\"high\":450.98,\"low\":439.5,\"close\":443.21,\"volume\":79491510,\"change\":-1.14,\"changePercent\":-0.25655,\"vwap\":444.51},{\"symbol\":\"TSLA\",\"date\":\"2025-09-26\",\"open\":428.3,\"high\":440.47,\"low\":421.02,\"close\":440.4,\"volume\":101628200,\"change\":12.1,\"changePercent\":2.83,\"vwap\":432.5475},{\"symbol\":\"TSLA\",\"date\":\"2025-09-25\",\"open\":435.24,\"high\":435.35,\"low\":419.08,\"close\":423.39,\"volume\":96746426,\"change\":-11.85,\"changePercent\":-2.72,\"vwap\":428.265},{\"symbol\":\"TSLA\",\"date\":\"2025-09-24\",\"open\":429.83,\"high\":444.21,\"low\":429.03,\"close\":442.79,\"volume\":93133600,\"change\":12.96,\"changePercent\":3.02,\"vwap\":436.465},{\"symbol\":\"TSLA\",\"date\":\"2025-09-23\",\"open\":439.88,\"high\":440.97,\"low\":423.72,\"close\":425.85,\"volume\":83422700,\"change\":-14.03,\"changePercent\":-3.19,\"vwap\":432.605},{\"symbol\":\"TSLA\",\"date\":\"2025-09-22\",\"open\":431.11,\"high\":444.98,\"low\":429.13,\"close\":434.21,\"volume\":97108800,\"change\":3.1,\"changePercent\":0.71907,\"vwap\":434.8575},{\"symbol\":\"TSLA\",\"date\":\"2025-09-19\",\"open\":421.82,\"high\":429.47,\"low\":421.72,\"close\":426.07,\"volume\":93131034,\"change\":4.25,\"changePercent\":1.01,\"vwap\":424.77},{\"symbol\":\"TSLA\",\"date\":\"2025-09-18\",\"open\":428.87,\"high\":432.22,\"low\":416.56,\"close\":416.85,\"volume\":90454509,\"change\":-12.01,\"changePercent\":-2.8,\"vwap\":423.625},{\"symbol\":\"TSLA\",\"date\":\"2025-09-17\",\"open\":415.75,\"high\":428.31,\"low\":409.67,\"close\":425.86,\"volume\":106133532,\"change\":10.11,\"changePercent\":2.43,\"vwap\":419.8975},{\"symbol\":\"TSLA\",\"date\":\"2025-09-16\",\"open\":414.5,\"high\":423.25,\"low\":411.43,\"close\":421.62,\"volume\":104285721,\"change\":7.13,\"changePercent\":1.72,\"vwap\":417.7},{\"symbol\":\"TSLA\",\"date\":\"2025-09-15\",\"open\":423.13,\"high\":425.7,\"low\":402.43,\"close\":410.04,\"volume\":163823700,\"change\":-13.09,\"changePercent\":-3.09,\"vwap\":415.325},{\"symbol\":\"TSLA\",\"date\":\"2025-09-12\",\"open\":370.94,\"high\":396.69,\"low\":370.24,\"close\":395.94,\"volume\":168156400,\"change\":25,\"changePercent\":6.74,\"vwap\":383.4525},{\"symbol\":\"TSLA\",\"date\":\"2025-09-11\",\"open\":350.17,\"high\":368.99,\"low\":347.6,\"close\":368.81,\"volume\":103756010,\"change\":18.64,\"changePercent\":5.32,\"vwap\":358.8925},{\"symbol\":\"TSLA\",\"date\":\"2025-09-10\",\"open\":350.55,\"high\":356.33,\"low\":346.07,\"close\":347.79,\"volume\":72121700,\"change\":-2.76,\"changePercent\":-0.78733,\"vwap\":350.185},{\"symbol\":\"TSLA\",\"date\":\"2025-09-09\",\"open\":348.44,\"high\":350.77,\"low\":343.82,\"close\":346.97,\"volume\":53816000,\"change\":-1.47,\"changePercent\":-0.42188,\"vwap\":347.5},{\"symbol\":\"TSLA\",\"date\":\"2025-09-08\",\"open\":354.64,\"high\":358.44,\"low\":344.84,\"close\":346.4,\"volume\":75208300,\"change\":-8.24,\"changePercent\":-2.32,\"vwap\":351.08},{\"symbol\":\"TSLA\",\"date\":\"2025-09-05\",\"open\":348,\"high\":355.87,\"low\":344.68,\"close\":350.84,\"volume\":108989800,\"change\":2.84,\"changePercent\":0.81609,\"vwap\":349.8475},{\"symbol\":\"TSLA\",\"date\":\"2025-09-04\",\"open\":336.15,\"high\":338.89,\"low\":331.48,\"close\":338.53,\"volume\":60711033,\"change\":2.38,\"changePercent\":0.70802,\"vwap\":336.2625},{\"symbol\":\"TSLA\",\"date\":\"2025-09-03\",\"open\":335.2,\"high\":343.33,\"low\":328.51,\"close\":334.09,\"volume\":88733300,\"change\":-1.11,\"changePercent\":-0.33115,\"vwap\":335.2825},{\"symbol\":\"TSLA\",\"date\":\"2025-09-02\",\"open\":328.23,\"high\":333.33,\"low\":325.6,\"close\":329.36,\"volume\":58392000,\"change\":1.13,\"changePercent\":0.34427,\"vwap\":329.13}]";
 
-  JsonDocument doc;
-  DeserializationError error = deserializeJson(doc, dummy_json_str);
+  lv_chart_set_range(chart, LV_CHART_AXIS_PRIMARY_Y, stock_widget_data.chart_stats.min, stock_widget_data.chart_stats.max);
+  // Writing exactly as many values as there are points wraps the ring fully, so the order is kept
+  for (size_t i = 0; i < point_count; i++)
+  {
+    bool is_live_close = stock_widget_data.has_live_point && !append_live_point && i == point_count - 1;
+    int32_t price = is_live_close ? stock_widget_data.live_point_value : value(context, stock_chart_points[i]);
+    lv_chart_set_next_value(chart, chart_series, price);
+    stock_chart_drawn_points[i] = {stock_series_day(series, stock_chart_candidate_bar(stock_chart_points[i], is_bucketed)), price};
+  }
+  if (append_live_point)
+  {
+    lv_chart_set_next_value(chart, chart_series, stock_widget_data.live_point_value);
+    stock_chart_drawn_points[point_count] = {stock_widget_data.live_point_day, stock_widget_data.live_point_value};
+  }
+  stock_chart_drawn_point_count = point_count + append_live_point;
+  stock_chart_drawn_min = stock_widget_data.chart_stats.min;
+  stock_chart_drawn_max = stock_widget_data.chart_stats.max;
+}
 
-  if (error)
+// One candle per bar while they fit, otherwise the bars of each bucket merged: the open of the first, the
+// close of the last and the low and high from the pyramid. The live quote closes the last candle, or
+// opens a new one on a new trading day
+static size_t select_stock_candles(void)
+{
+  const stock_series &series = *stock_widget_data.series;
+  size_t first = stock_widget_data.chart_first;
+  size_t count = stock_widget_data.chart_count;
+  bool append_live_point = is_live_point_appended();
+  size_t candle_count = min(count, STOCK_CANDLE_MAX - append_live_point);
+  for (size_t candle = 0; candle < candle_count; candle++)
   {
-    Serial.printf("JSON parsing failed: %s\n", error.c_str());
-    return {false, {}};
+    size_t bucket_first = first + candle * count / candle_count;
+    size_t bucket_end = first + (candle + 1) * count / candle_count;
+    stock_series_stats stats = stock_series_window_stats(series, bucket_first, bucket_end - bucket_first);
+    stock_candles[candle] = {stock_series_open(series, bucket_first), stats.last_close, stats.max, stats.min, stock_series_day(series, bucket_end - 1)};
   }
 
-  std::vector<stock_month_chart_data_item> items;
-  for (JsonObject entry : doc.as<JsonArray>())
+  int32_t live = stock_widget_data.live_point_value;
+  if (append_live_point)
+  {
+    int32_t open = stock_candles[candle_count - 1].close;
+    stock_candles[candle_count++] = {open, live, max(open, live), min(open, live), stock_widget_data.live_point_day};
+  }
+  else if (stock_widget_data.has_live_point)
   {
-    items.push_back({
-        .date = entry["date"] ? (std::string)entry["date"].as<std::string>() : "",
-        .open_price = entry["open"] ? entry["open"].as<float>() : 0.0f,
-        .close_price = entry["close"] ? entry["close"].as<float>() : 0.0f,
-    });
+    stock_candle *last = &stock_candles[candle_count - 1];
+    *last = {last->open, live, max(last->high, live), min(last->low, live), last->day};
   }
-  return {true, items};
+  return candle_count;
+}
+
+// Overlays may leave the price range, they are clipped to the canvas
+static int32_t stock_candle_y(int32_t price)
+{
+  const stock_series_stats &stats = stock_widget_data.chart_stats;
+  int32_t range = max(stats.max - stats.min, (int32_t)1);
+  int64_t y = (int64_t)(stats.max - price) * (STOCK_CHART_HEIGHT - 1) / range;
+  return min(max(y, (int64_t)0), (int64_t)STOCK_CHART_HEIGHT - 1);
+}
+
+static int32_t stock_candle_x(size_t candle, size_t candle_count)
+{
+  return (2 * candle + 1) * STOCK_CHART_WIDTH / (2 * candle_count);
 }
 
-bool load_stock_widget_data(void)
+// One polyline per overlay through the candle centers, at the last bar of each candle
+static void render_stock_candle_overlays(lv_layer_t *layer, size_t candle_count)
 {
-  auto [is_items_valid, items] = request_stock_info();
-  // auto [is_items_valid, items] = request_stock_info_dummy(); // dummy data
-  if (!is_items_valid)
+  const stock_series &series = *stock_widget_data.series;
+  size_t bucketed_count = candle_count - is_live_point_appended();
+  lv_draw_line_dsc_t line;
+  lv_draw_line_dsc_init(&line);
+  line.width = 1;
+  for (const stock_overlay &overlay : stock_overlays)
   {
-    Serial.println("load_stock_widget_data failed");
-    return false;
+    if (!is_stock_overlay_shown(overlay))
+    {
+      continue;
+    }
+    line.color = lv_palette_main(overlay.palette);
+    int32_t previous = STOCK_INDICATOR_NONE;
+    for (size_t candle = 0; candle < candle_count; candle++)
+    {
+      size_t bar = candle < bucketed_count ? stock_widget_data.chart_first + (candle + 1) * stock_widget_data.chart_count / bucketed_count - 1 : series.count - 1;
+      int32_t value = stock_overlay_value(overlay, bar);
+      if (previous != STOCK_INDICATOR_NONE && value != STOCK_INDICATOR_NONE)
+      {
+        line.p1 = {stock_candle_x(candle - 1, candle_count), stock_candle_y(previous)};
+        line.p2 = {stock_candle_x(candle, candle_count), stock_candle_y(value)};
+        lv_draw_line(layer, &line);
+      }
+      previous = value;
+    }
   }
+}
 
-  std::vector<int32_t> display_chart_data = {};
-  for (int i = items.size() - 1; i >= 0; i--)
+// A wick and a body per candle, both plain rectangles, which software rendering fills fastest
+static void render_stock_chart_candles(void)
+{
+  lv_canvas_fill_bg(candle_canvas, lv_palette_darken(LV_PALETTE_GREY, 4), LV_OPA_COVER);
+  stock_chart_drawn_point_count = 0;
+  if (stock_widget_data.chart_count == 0)
   {
-    display_chart_data.push_back((int32_t)items[i].open_price);
-    display_chart_data.push_back((int32_t)items[i].close_price);
+    return;
   }
-  float latest_price = items[0].close_price;
-  float previous_close_price = items[items.size() - 1].close_price;
+  size_t candle_count = select_stock_candles();
+  int32_t pitch = STOCK_CHART_WIDTH / candle_count;
+  int32_t body_half_width = min(pitch / 3, STOCK_CANDLE_MAX_BODY_WIDTH / 2);
 
-  stock_widget_data.stock_ticker = STOCK_TICKER;
-  stock_widget_data.company_name = "Tesla, Inc.";
-  stock_widget_data.price = latest_price;
-  stock_widget_data.dollar_change = latest_price - previous_close_price;
-  stock_widget_data.percent_change = ((previous_close_price != 0.0f) ? (stock_widget_data.dollar_change / previous_close_price) * 100.0f : 0.0f);
-  stock_widget_data.month_chart_data = items;
-  stock_widget_data.display_chart_data = display_chart_data;
-  stock_widget_data.price_positive = (latest_price >= previous_close_price);
-  stock_widget_data.is_loading = false;
-  return true;
+  lv_layer_t layer;
+  lv_canvas_init_layer(candle_canvas, &layer);
+  lv_draw_rect_dsc_t rect;
+  lv_draw_rect_dsc_init(&rect);
+  rect.radius = 0;
+  for (size_t i = 0; i < candle_count; i++)
+  {
+    const stock_candle &candle = stock_candles[i];
+    int32_t x = stock_candle_x(i, candle_count);
+    rect.bg_color = candle.close >= candle.open ? lv_palette_main(LV_PALETTE_GREEN) : lv_palette_main(LV_PALETTE_RED);
+    lv_area_t wick = {x, stock_candle_y(candle.high), x, stock_candle_y(candle.low)};
+    lv_draw_rect(&layer, &rect, &wick);
+    lv_area_t body = {x - body_half_width, stock_candle_y(max(candle.open, candle.close)), x + body_half_width, stock_candle_y(min(candle.open, candle.close))};
+    lv_draw_rect(&layer, &rect, &body);
+    stock_chart_drawn_points[i] = {candle.day, candle.close};
+  }
+  stock_chart_drawn_point_count = candle_count;
+  render_stock_candle_overlays(&layer, candle_count);
+  lv_canvas_finish_layer(candle_canvas, &layer);
+}
+
+// lvgl invalidates a label on every set, even to the same text
+static void set_label_text_if_changed(lv_obj_t *label, const std::string &text)
+{
+  const char *shown = lv_label_get_text(label);
+  if (text != shown)
+  {
+    lv_label_set_text(label, text.c_str());
+  }
+}
+
+static void hide_stock_crosshair(void)
+{
+  if (crosshair_label != nullptr && !lv_obj_has_flag(crosshair_label, LV_OBJ_FLAG_HIDDEN))
+  {
+    lv_obj_add_flag(crosshair_vertical, LV_OBJ_FLAG_HIDDEN);
+    lv_obj_add_flag(crosshair_horizontal, LV_OBJ_FLAG_HIDDEN);
+    lv_obj_add_flag(crosshair_label, LV_OBJ_FLAG_HIDDEN);
+  }
+}
+
+// Moves the crosshair to the drawn point or candle nearest to screen_x, found by arithmetic: the line's
+// points are spread evenly over the chart's content box, the candles over the canvas. The crosshair is
+// two thin objects and a label over the chart, moving them invalidates their own strips only, so the
+// chart under them is redrawn just there and the line or canvas is not touched
+static void show_stock_crosshair(int32_t screen_x)
+{
+  int32_t count = stock_chart_drawn_point_count;
+  if (count == 0)
+  {
+    hide_stock_crosshair();
+    return;
+  }
+  lv_area_t span;
+  if (stock_chart_candles)
+  {
+    lv_obj_get_coords(candle_canvas, &span);
+  }
+  else
+  {
+    lv_obj_get_content_coords(chart, &span);
+  }
+  int32_t width = lv_area_get_width(&span);
+  int32_t height = lv_area_get_height(&span);
+  int32_t offset = screen_x - span.x1;
+  int32_t index;
+  int32_t x;
+  if (stock_chart_candles)
+  {
+    index = min(max(offset * count / width, (int32_t)0), count - 1);
+    x = stock_candle_x(index, count);
+  }
+  else
+  {
+    index = count == 1 ? 0 : min(max((2 * offset * (count - 1) + width - 1) / (2 * (width - 1)), (int32_t)0), count - 1);
+    x = count == 1 ? 0 : index * (width - 1) / (count - 1);
+  }
+  stock_chart_drawn_point point = stock_chart_drawn_points[index];
+  // No single day closed at the low or high of a bucket, so on long ranges the crosshair shows the bar under
+  // the finger instead. The live quote at the end is a real price
+  bool is_live = stock_widget_data.has_live_point && index == count - 1;
+  if (!stock_chart_candles && stock_chart_drawn_bucketed && !is_live)
+  {
+    const stock_series &series = *stock_widget_data.series;
+    x = min(max(offset, (int32_t)0), width - 1);
+    size_t bar = stock_widget_data.chart_first + x * stock_widget_data.chart_count / width;
+    point = {stock_series_day(series, bar), stock_series_close(series, bar)};
+  }
+  int32_t y;
+  if (stock_chart_candles)
+  {
+    y = stock_candle_y(point.price);
+  }
+  else
+  {
+    int32_t range = max(stock_chart_drawn_max - stock_chart_drawn_min, (int32_t)1);
+    y = (int64_t)(stock_chart_drawn_max - point.price) * (height - 1) / range;
+  }
+
+  lv_area_t area;
+  lv_obj_get_coords(chart_scrub_area, &area);
+  x += span.x1 - area.x1;
+  y += span.y1 - area.y1;
+  lv_obj_set_pos(crosshair_vertical, x, 0);
+  lv_obj_set_pos(crosshair_horizontal, 0, y);
+  set_label_text_if_changed(crosshair_label, epoch_day_to_date_str(point.day) + " " + round_float_to_string(stock_price_from_fixed(point.price), 2));
+  // Above the price unless it is near the top, then below
+  int32_t label_x = min(max(x - STOCK_CROSSHAIR_LABEL_WIDTH / 2, (int32_t)0), (int32_t)STOCK_CHART_WIDTH - STOCK_CROSSHAIR_LABEL_WIDTH);
+  int32_t label_y = y < STOCK_CROSSHAIR_LABEL_HEIGHT + 4 ? STOCK_CHART_HEIGHT - STOCK_CROSSHAIR_LABEL_HEIGHT : 0;
+  lv_obj_set_pos(crosshair_label, label_x, label_y);
+  if (lv_obj_has_flag(crosshair_label, LV_OBJ_FLAG_HIDDEN))
+  {
+    lv_obj_remove_flag(crosshair_vertical, LV_OBJ_FLAG_HIDDEN);
+    lv_obj_remove_flag(crosshair_horizontal, LV_OBJ_FLAG_HIDDEN);
+    lv_obj_remove_flag(crosshair_label, LV_OBJ_FLAG_HIDDEN);
+  }
+}
+
+static stock_chart_key current_stock_chart_key(void)
+{
+  const stock_series *series = stock_widget_data.series;
+  return {
+      .series = series,
+      .revision = series != nullptr ? series->revision : 0,
+      .first = stock_widget_data.chart_first,
+      .count = stock_widget_data.chart_count,
+      .has_live_point = stock_widget_data.has_live_point,
+      .live_point_value = stock_widget_data.live_point_value,
+      .live_point_day = stock_widget_data.live_point_day,
+      .candles = stock_chart_candles,
+  };
+}
+
+static bool is_same_stock_chart_key(const stock_chart_key &a, const stock_chart_key &b)
+{
+  return std::tie(a.series, a.revision, a.first, a.count, a.has_live_point, a.live_point_value, a.live_point_day, a.candles) ==
+         std::tie(b.series, b.revision, b.first, b.count, b.has_live_point, b.live_point_value, b.live_point_day, b.candles);
+}
+
+// Redraws the line or the candles only when their data, window or style changed. Refreshes of other
+// tickers and of the labels render the widget too, those keep the drawn chart
+void render_stock_chart(void)
+{
+  stock_chart_key key = current_stock_chart_key();
+  if (is_stock_chart_drawn && is_same_stock_chart_key(key, stock_chart_drawn_key))
+  {
+    stock_chart_skipped_redraws++;
+    return;
+  }
+  // The point under the crosshair may be gone, the next touch event shows it again
+  hide_stock_crosshair();
+  if (stock_chart_candles)
+  {
+    render_stock_chart_candles();
+  }
+  else
+  {
+    render_stock_chart_line();
+  }
+  stock_chart_drawn_key = key;
+  is_stock_chart_drawn = true;
+  stock_chart_redraws++;
+}
+
+// Moves the end of the line to the live quote. Only the last segment is invalidated while the window, the
+// day of the quote and the y range hold, anything else is a full render
+static void update_stock_chart_live_point(void)
+{
+  stock_chart_key key = current_stock_chart_key();
+  stock_chart_key drawn_live_value = stock_chart_drawn_key;
+  drawn_live_value.live_point_value = key.live_point_value;
+  bool is_bucketed = stock_widget_data.chart_count * 2 > STOCK_CHART_CANDIDATES;
+  uint32_t point_count = lv_chart_get_point_count(chart);
+  // The candle canvas is rasterized whole, the candles are cheap to redraw
+  if (stock_chart_candles || !is_stock_chart_drawn || !key.has_live_point || !is_same_stock_chart_key(key, drawn_live_value) || is_bucketed ||
+      point_count == 0 || stock_chart_drawn_point_count == 0 || stock_widget_data.chart_stats.min != stock_chart_drawn_min ||
+      stock_widget_data.chart_stats.max != stock_chart_drawn_max)
+  {
+    render_stock_chart();
+    return;
+  }
+  uint32_t start = lv_chart_get_x_start_point(chart, chart_series);
+  uint32_t last = (start + point_count - 1) % point_count;
+  lv_chart_set_value_by_id(chart, chart_series, last, stock_widget_data.live_point_value);
+  stock_chart_drawn_points[stock_chart_drawn_point_count - 1].price = stock_widget_data.live_point_value;
+  stock_chart_drawn_key = key;
 }
 
 void init_render_stock_widget(lv_obj_t *parent)
@@ -156,7 +622,6 @@ void init_render_stock_widget(lv_obj_t *parent)
   float price = stock_widget_data.price;
   float percent_change = stock_widget_data.percent_change;
   float dollar_change = stock_widget_data.dollar_change;
-  std::vector<int32_t> *chart_data = &stock_widget_data.display_chart_data;
   bool price_positive = stock_widget_data.price_positive;
 
   auto primary_color = (price_positive) ? lv_palette_main(LV_PALETTE_GREEN) : lv_palette_main(LV_PALETTE_RED);
@@ -174,29 +639,93 @@ void init_render_stock_widget(lv_obj_t *parent)
   // Chart setup
   chart = lv_chart_create(stock_widget_box);
   lv_obj_add_flag(chart, LV_OBJ_FLAG_EVENT_BUBBLE);
-  lv_obj_set_size(chart, 200, 90);
-  lv_obj_center(chart);
+  lv_obj_set_size(chart, STOCK_CHART_WIDTH, STOCK_CHART_HEIGHT);
+  lv_obj_align(chart, LV_ALIGN_CENTER, 0, -10);
   lv_chart_set_type(chart, LV_CHART_TYPE_LINE);
   lv_chart_set_div_line_count(chart, 0, 0);
   lv_obj_set_style_size(chart, 0, 0, LV_PART_INDICATOR); // No point circles
-  lv_obj_set_style_width(chart, 5, LV_PART_ITEMS);       // Line width
+  lv_obj_set_style_width(chart, STOCK_CHART_INDICATORS ? 2 : 5, LV_PART_ITEMS); // Line width, thin next to overlays
   lv_obj_set_style_bg_color(chart, lv_palette_darken(LV_PALETTE_GREY, 4), LV_PART_MAIN);
   lv_obj_set_style_border_width(chart, 0, LV_PART_MAIN);
-  lv_chart_set_point_count(chart, chart_data->size());
-
-  lv_chart_series_t *ser1 = lv_chart_add_series(chart, primary_color, LV_CHART_AXIS_PRIMARY_Y);
 
-  if (!chart_data->empty())
+  for (stock_overlay &overlay : stock_overlays)
   {
-    auto minmax = std::minmax_element(chart_data->begin(), chart_data->end());
-    lv_coord_t min = *minmax.first;
-    lv_coord_t max = *minmax.second;
-    lv_chart_set_range(chart, LV_CHART_AXIS_PRIMARY_Y, min, max);
-    for (size_t i = 0; i < chart_data->size(); ++i)
+    if (is_stock_overlay_shown(overlay))
     {
-      lv_chart_set_next_value(chart, ser1, (*chart_data)[i]);
+      overlay.chart_series = lv_chart_add_series(chart, lv_palette_main(overlay.palette), LV_CHART_AXIS_PRIMARY_Y);
     }
   }
+  chart_series = lv_chart_add_series(chart, primary_color, LV_CHART_AXIS_PRIMARY_Y);
+
+  // Candle canvas in the same place, RGB565 without alpha: the background is part of the raster
+  size_t canvas_size = LV_CANVAS_BUF_SIZE(STOCK_CHART_WIDTH, STOCK_CHART_HEIGHT, 16, LV_DRAW_BUF_STRIDE_ALIGN);
+  candle_canvas_buffer = (uint8_t *)heap_caps_malloc(canvas_size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+  candle_canvas = lv_canvas_create(stock_widget_box);
+  lv_obj_add_flag(candle_canvas, LV_OBJ_FLAG_EVENT_BUBBLE);
+  if (candle_canvas_buffer != nullptr)
+  {
+    lv_canvas_set_buffer(candle_canvas, candle_canvas_buffer, STOCK_CHART_WIDTH, STOCK_CHART_HEIGHT, LV_COLOR_FORMAT_RGB565);
+  }
+  else
+  {
+    Serial.printf("Stock chart: allocating %u bytes for candles failed, drawing a line\n", canvas_size);
+  }
+  lv_obj_align(candle_canvas, LV_ALIGN_CENTER, 0, -10);
+  stock_widget_set_chart_candles(stock_chart_candles);
+
+  // Crosshair over both chart styles, without styles of its own the scrub area draws nothing. Dragging on
+  // it scrubs the chart instead of scrolling the tiles
+  chart_scrub_area = lv_obj_create(stock_widget_box);
+  lv_obj_remove_style_all(chart_scrub_area);
+  lv_obj_set_size(chart_scrub_area, STOCK_CHART_WIDTH, STOCK_CHART_HEIGHT);
+  lv_obj_align(chart_scrub_area, LV_ALIGN_CENTER, 0, -10);
+  lv_obj_remove_flag(chart_scrub_area, LV_OBJ_FLAG_SCROLL_CHAIN);
+  lv_obj_remove_flag(chart_scrub_area, LV_OBJ_FLAG_SCROLLABLE);
+
+  crosshair_vertical = lv_obj_create(chart_scrub_area);
+  crosshair_horizontal = lv_obj_create(chart_scrub_area);
+  lv_obj_t *crosshair_lines[] = {crosshair_vertical, crosshair_horizontal};
+  for (lv_obj_t *line : crosshair_lines)
+  {
+    lv_obj_remove_style_all(line);
+    lv_obj_set_style_bg_color(line, lv_color_white(), LV_PART_MAIN);
+    lv_obj_set_style_bg_opa(line, LV_OPA_60, LV_PART_MAIN);
+    lv_obj_remove_flag(line, LV_OBJ_FLAG_CLICKABLE);
+    lv_obj_add_flag(line, LV_OBJ_FLAG_HIDDEN);
+  }
+  lv_obj_set_size(crosshair_vertical, 1, STOCK_CHART_HEIGHT);
+  lv_obj_set_size(crosshair_horizontal, STOCK_CHART_WIDTH, 1);
+
+  // Fixed size, so a new text needs no layout
+  crosshair_label = lv_label_create(chart_scrub_area);
+  lv_obj_set_size(crosshair_label, STOCK_CROSSHAIR_LABEL_WIDTH, STOCK_CROSSHAIR_LABEL_HEIGHT);
+  lv_obj_set_style_text_font(crosshair_label, &lv_font_montserrat_14, 0);
+  lv_obj_set_style_text_color(crosshair_label, lv_color_white(), 0);
+  lv_obj_set_style_text_align(crosshair_label, LV_TEXT_ALIGN_CENTER, 0);
+  lv_obj_set_style_bg_color(crosshair_label, lv_color_black(), 0);
+  lv_obj_set_style_bg_opa(crosshair_label, LV_OPA_70, 0);
+  lv_obj_set_style_radius(crosshair_label, 4, 0);
+  lv_obj_add_flag(crosshair_label, LV_OBJ_FLAG_HIDDEN);
+
+  // Chart range buttons, one object for all of them
+  chart_range_buttons = lv_buttonmatrix_create(stock_widget_box);
+  lv_buttonmatrix_set_map(chart_range_buttons, stock_chart_range_map);
+  lv_buttonmatrix_set_button_ctrl_all(chart_range_buttons, LV_BUTTONMATRIX_CTRL_CHECKABLE);
+  lv_buttonmatrix_set_one_checked(chart_range_buttons, true);
+  lv_buttonmatrix_set_button_ctrl(chart_range_buttons, stock_chart_range, LV_BUTTONMATRIX_CTRL_CHECKED);
+  lv_obj_set_size(chart_range_buttons, STOCK_CHART_WIDTH, 22);
+  lv_obj_align(chart_range_buttons, LV_ALIGN_CENTER, 0, 36);
+  lv_obj_set_style_bg_opa(chart_range_buttons, LV_OPA_TRANSP, LV_PART_MAIN);
+  lv_obj_set_style_border_width(chart_range_buttons, 0, LV_PART_MAIN);
+  lv_obj_set_style_pad_all(chart_range_buttons, 0, LV_PART_MAIN);
+  lv_obj_set_style_pad_column(chart_range_buttons, 4, LV_PART_MAIN);
+  lv_obj_set_style_text_font(chart_range_buttons, &lv_font_montserrat_14, LV_PART_ITEMS);
+  lv_obj_set_style_text_color(chart_range_buttons, lv_palette_lighten(LV_PALETTE_GREY, 1), LV_PART_ITEMS);
+  lv_obj_set_style_bg_opa(chart_range_buttons, LV_OPA_TRANSP, LV_PART_ITEMS);
+  lv_obj_set_style_shadow_width(chart_range_buttons, 0, LV_PART_ITEMS);
+  lv_obj_set_style_bg_opa(chart_range_buttons, LV_OPA_COVER, LV_PART_ITEMS | LV_STATE_CHECKED);
+  lv_obj_set_style_bg_color(chart_range_buttons, lv_palette_darken(LV_PALETTE_GREY, 2), LV_PART_ITEMS | LV_STATE_CHECKED);
+  lv_obj_set_style_text_color(chart_range_buttons, lv_color_white(), LV_PART_ITEMS | LV_STATE_CHECKED);
 
   // Display stock ticker trend arrow
   stock_ticker_arrow_label = lv_label_create(stock_widget_box);
@@ -245,10 +774,636 @@ void init_render_stock_widget(lv_obj_t *parent)
   lv_obj_set_style_text_color(dollar_change_label, primary_color, 0);
   lv_obj_set_style_text_font(dollar_change_label, &lv_font_montserrat_20, 0);
   lv_obj_align(dollar_change_label, LV_ALIGN_TOP_RIGHT, 0, 30);
+
+  // Display data age while the data is not fresh
+  data_age_label = lv_label_create(stock_widget_box);
+  lv_obj_add_flag(data_age_label, LV_OBJ_FLAG_EVENT_BUBBLE);
+  lv_obj_set_style_text_font(data_age_label, &lv_font_montserrat_14, 0);
+  lv_obj_set_style_text_color(data_age_label, lv_palette_lighten(LV_PALETTE_GREY, 1), 0);
+  lv_obj_align(data_age_label, LV_ALIGN_BOTTOM_LEFT, 0, 0);
+
+  // Display the watchlist page, hidden for a single ticker
+  watchlist_page_label = lv_label_create(stock_widget_box);
+  lv_obj_add_flag(watchlist_page_label, LV_OBJ_FLAG_EVENT_BUBBLE);
+  lv_obj_set_style_text_font(watchlist_page_label, &lv_font_montserrat_14, 0);
+  lv_obj_set_style_text_color(watchlist_page_label, lv_palette_lighten(LV_PALETTE_GREY, 1), 0);
+  lv_obj_align(watchlist_page_label, LV_ALIGN_BOTTOM_LEFT, 0, -18);
+}
+
+// The state of the shown data, the label is hidden while it is ready
+void update_stock_widget_data_age(void)
+{
+  switch (stock_widget_data.state)
+  {
+  case STOCK_DATA_LOADING:
+    lv_label_set_text(data_age_label, LV_SYMBOL_REFRESH " loading");
+    break;
+  case STOCK_DATA_STALE:
+    lv_label_set_text_fmt(data_age_label, "%s %s", LV_SYMBOL_REFRESH, format_data_age(stock_widget_data.updated_at).c_str());
+    break;
+  case STOCK_DATA_ERROR:
+    lv_label_set_text(data_age_label, LV_SYMBOL_WARNING " no data");
+    break;
+  case STOCK_DATA_READY:
+    lv_obj_add_flag(data_age_label, LV_OBJ_FLAG_HIDDEN);
+    return;
+  }
+  lv_obj_remove_flag(data_age_label, LV_OBJ_FLAG_HIDDEN);
+}
+
+// Patch the existing objects with the current stock_widget_data, must be called with the lvgl lock held
+void update_render_stock_widget(void)
+{
+  auto primary_color = (stock_widget_data.price_positive) ? lv_palette_main(LV_PALETTE_GREEN) : lv_palette_main(LV_PALETTE_RED);
+
+  lv_label_set_text(stock_ticker_label, stock_widget_data.stock_ticker.c_str());
+  lv_label_set_text(company_name_label, stock_widget_data.company_name.c_str());
+  lv_label_set_text(stock_ticker_arrow_label, stock_widget_data.price_positive ? LV_SYMBOL_UP : LV_SYMBOL_DOWN);
+  lv_obj_set_style_text_color(stock_ticker_arrow_label, primary_color, 0);
+  lv_label_set_text(latest_price_label, round_float_to_string(stock_widget_data.price, 2).c_str());
+  lv_label_set_text_fmt(percent_change_label, stock_widget_data.percent_change >= 0 ? "+%s%%" : "%s%%", round_float_to_string(stock_widget_data.percent_change, 2).c_str());
+  lv_obj_set_style_text_color(percent_change_label, primary_color, 0);
+  lv_label_set_text_fmt(dollar_change_label, stock_widget_data.dollar_change >= 0 ? "+%s" : "%s", round_float_to_string(stock_widget_data.dollar_change, 2).c_str());
+  lv_obj_set_style_text_color(dollar_change_label, primary_color, 0);
+
+  if (stock_widget_data.chart_count == 0)
+  {
+    lv_label_set_text(latest_price_label, "--");
+    lv_label_set_text(percent_change_label, "");
+    lv_label_set_text(dollar_change_label, "");
+  }
+  if (stock_watchlist_size() > 1)
+  {
+    lv_label_set_text_fmt(watchlist_page_label, "%u/%u", stock_widget_shown + 1, stock_watchlist_size());
+  }
+  else
+  {
+    lv_obj_add_flag(watchlist_page_label, LV_OBJ_FLAG_HIDDEN);
+  }
+
+  lv_chart_set_series_color(chart, chart_series, primary_color);
+  render_stock_chart();
+
+  update_stock_widget_data_age();
+}
+
+// Shows the chart object of the style and redraws it, a line when there is no canvas buffer
+extern "C" void stock_widget_set_chart_candles(bool candles)
+{
+  if (chart == nullptr)
+  {
+    return;
+  }
+  stock_chart_candles = candles && candle_canvas_buffer != nullptr;
+  if (stock_chart_candles)
+  {
+    lv_obj_add_flag(chart, LV_OBJ_FLAG_HIDDEN);
+    lv_obj_remove_flag(candle_canvas, LV_OBJ_FLAG_HIDDEN);
+  }
+  else
+  {
+    lv_obj_add_flag(candle_canvas, LV_OBJ_FLAG_HIDDEN);
+    lv_obj_remove_flag(chart, LV_OBJ_FLAG_HIDDEN);
+  }
+  render_stock_chart();
+}
+
+extern "C" void stock_widget_print_chart_stats(void)
+{
+  Serial.printf("Stock chart: %s, %lu redraws, %lu skipped as unchanged\n", stock_chart_candles ? "candles" : "line",
+                stock_chart_redraws, stock_chart_skipped_redraws);
+}
+
+extern "C" void stock_widget_print_data_source(void)
+{
+  Serial.printf("Stock data source: %s (", stock_source != nullptr ? stock_source->name : "none");
+  for (size_t i = 0; i < stock_data_source_count(); i++)
+  {
+    Serial.printf("%s%s", i > 0 ? ", " : "", stock_data_source_at(i)->name);
+  }
+  Serial.println(")");
+}
+
+// Switched by the refresh task between two fetches, so no fetch of the old source is merged afterwards
+extern "C" bool stock_widget_set_data_source(const char *name)
+{
+  const stock_data_source *source = stock_data_source_find(name);
+  if (source == nullptr || stock_watchlist_task == NULL)
+  {
+    return false;
+  }
+  stock_source_requested = source;
+  xTaskNotifyGive(stock_watchlist_task);
+  return true;
+}
+
+// A data update is one forced render_stock_chart. A static frame is one synchronous refresh of the chart
+// area with unchanged data, flushing the same area to the panel for both styles
+extern "C" void stock_widget_bench_chart(void)
+{
+  if (chart == nullptr)
+  {
+    Serial.println("Stock chart is not rendered");
+    return;
+  }
+  lv_lock();
+  bool candles = stock_chart_candles;
+  for (int style = 0; style < 2; style++)
+  {
+    stock_widget_set_chart_candles(style == 1);
+    if (stock_chart_candles != (style == 1))
+    {
+      continue;
+    }
+    lv_obj_t *chart_object = stock_chart_candles ? candle_canvas : chart;
+    uint32_t update_us = 0;
+    uint32_t frame_us = 0;
+    uint32_t scrub_us = 0;
+    for (int run = 0; run < STOCK_CHART_BENCH_RUNS; run++)
+    {
+      is_stock_chart_drawn = false;
+      uint32_t start = micros();
+      render_stock_chart();
+      update_us += micros() - start;
+      lv_refr_now(NULL);
+
+      lv_obj_invalidate(chart_object);
+      start = micros();
+      lv_refr_now(NULL);
+      frame_us += micros() - start;
+    }
+    // A scrub frame moves the crosshair across the chart, one step per run
+    lv_area_t area;
+    lv_obj_get_coords(chart_scrub_area, &area);
+    for (int run = 0; run < STOCK_CHART_BENCH_RUNS; run++)
+    {
+      uint32_t start = micros();
+      show_stock_crosshair(area.x1 + run * STOCK_CHART_WIDTH / STOCK_CHART_BENCH_RUNS);
+      lv_refr_now(NULL);
+      scrub_us += micros() - start;
+    }
+    hide_stock_crosshair();
+    lv_refr_now(NULL);
+    Serial.printf("Stock chart %-7s: data update %6lu us, static frame %6lu us, scrub frame %6lu us, %u bars in the window\n",
+                  stock_chart_candles ? "candles" : "line", update_us / STOCK_CHART_BENCH_RUNS, frame_us / STOCK_CHART_BENCH_RUNS,
+                  scrub_us / STOCK_CHART_BENCH_RUNS, stock_widget_data.chart_count);
+  }
+  stock_widget_set_chart_candles(candles);
+  lv_unlock();
+}
+
+// Patches a new quote of the ticker on screen into the existing objects: the price and change labels whose
+// text changed and the end of the chart line. Must be called with the lvgl lock held
+static void update_stock_widget_live_quote(void)
+{
+  stock_watchlist_entry *entry = stock_watchlist_entry_at(stock_widget_shown);
+  if (entry == nullptr)
+  {
+    return;
+  }
+  bool was_positive = stock_widget_data.price_positive;
+  if (!set_stock_widget_data(*entry) || !stock_widget_data.has_live_point || stock_widget_data.price_positive != was_positive)
+  {
+    // A flipped direction recolors the arrow, the labels and the line, which is most of the widget
+    update_render_stock_widget();
+    return;
+  }
+
+  std::string percent_change = round_float_to_string(stock_widget_data.percent_change, 2) + "%";
+  std::string dollar_change = round_float_to_string(stock_widget_data.dollar_change, 2);
+  set_label_text_if_changed(latest_price_label, round_float_to_string(stock_widget_data.price, 2));
+  set_label_text_if_changed(percent_change_label, stock_widget_data.percent_change >= 0 ? "+" + percent_change : percent_change);
+  set_label_text_if_changed(dollar_change_label, stock_widget_data.dollar_change >= 0 ? "+" + dollar_change : dollar_change);
+  update_stock_chart_live_point();
+  update_stock_widget_data_age();
+}
+
+// The market clock of the refresh schedule, always open with STOCK_MARKET_HOURS 0
+static bool is_stock_market_open(time_t now)
+{
+  return !STOCK_MARKET_HOURS || market_is_open(now);
+}
+
+// The last close whose daily bar is final at the apis. Data fetched after it stays fresh until the next one
+static time_t stock_settled_close(time_t now)
+{
+  return market_last_close(now - STOCK_CLOSE_SETTLE_S) + STOCK_CLOSE_SETTLE_S;
+}
+
+static time_t stock_history_stale_before(time_t now)
+{
+  return STOCK_MARKET_HOURS ? stock_settled_close(now) : now - STOCK_HISTORY_MAX_AGE_S;
+}
+
+// Ages the watchlist too, the task may sleep past the refresh interval while offline
+// While the market is closed nothing changes, data fetched after the last settled close stays ready
+static void on_stock_widget_data_age_timer(lv_timer_t *timer)
+{
+  time_t now = time(nullptr);
+  time_t stale_before = now - STOCK_DATA_STALE_AFTER_INTERVALS * radio_power_poll_interval_ms(REFRESH_STOCK_QUOTES_FREQ_MS) / 1000;
+  if (!is_stock_market_open(now))
+  {
+    stale_before = min(stale_before, stock_settled_close(now));
+  }
+  stock_watchlist_age(stale_before);
+  stock_watchlist_entry *entry = stock_watchlist_entry_at(stock_widget_shown);
+  if (entry != nullptr)
+  {
+    stock_widget_data.state = entry->state;
+  }
+  update_stock_widget_data_age();
+}
+
+// Renders the watchlist entry at index into the same objects, must be called with the lvgl lock held
+static void render_stock_watchlist_entry(size_t index)
+{
+  stock_watchlist_entry *entry = stock_watchlist_entry_at(index);
+  if (entry == nullptr)
+  {
+    return;
+  }
+  stock_widget_shown = index;
+  set_stock_widget_data(*entry);
+  update_render_stock_widget();
+}
+
+static void show_stock_watchlist_entry(size_t index)
+{
+  render_stock_watchlist_entry(index);
+  // Fetch the history of a ticker paged to before its round robin turn
+  stock_watchlist_entry *entry = stock_watchlist_entry_at(index);
+  if (entry != nullptr && entry->history_fetched_at == 0 && stock_watchlist_task != NULL)
+  {
+    xTaskNotifyGive(stock_watchlist_task);
+  }
+}
+
+// A drag shows the date and price under the finger until released. A tap pages like anywhere else on the
+// widget, a drag does not
+static void on_chart_scrub(lv_event_t *e)
+{
+  lv_event_code_t code = lv_event_get_code(e);
+  lv_point_t point;
+  lv_indev_get_point(lv_indev_active(), &point);
+  if (code == LV_EVENT_PRESSED)
+  {
+    chart_scrub_pressed_x = point.x;
+    is_chart_scrubbed = false;
+  }
+  if (code == LV_EVENT_PRESSED || code == LV_EVENT_PRESSING)
+  {
+    is_chart_scrubbed = is_chart_scrubbed || abs(point.x - chart_scrub_pressed_x) > STOCK_CHART_SCRUB_TAP_SLOP;
+    show_stock_crosshair(point.x);
+  }
+  else if (code == LV_EVENT_RELEASED || code == LV_EVENT_PRESS_LOST)
+  {
+    hide_stock_crosshair();
+  }
+  else if (code == LV_EVENT_CLICKED && !is_chart_scrubbed)
+  {
+    lv_obj_send_event(stock_widget_box, LV_EVENT_CLICKED, NULL);
+  }
+}
+
+// Switching needs no fetch and no scan of the history, the window stats and chart come from the pyramid
+static void on_chart_range_changed(lv_event_t *e)
+{
+  uint32_t range = lv_buttonmatrix_get_selected_button(chart_range_buttons);
+  if (range >= sizeof(STOCK_CHART_RANGE_DAYS) / sizeof(STOCK_CHART_RANGE_DAYS[0]) || range == stock_chart_range)
+  {
+    return;
+  }
+  stock_chart_range = range;
+  render_stock_watchlist_entry(stock_widget_shown);
+}
+
+static void on_stock_widget_clicked(lv_event_t *e)
+{
+  show_stock_watchlist_entry((stock_widget_shown + 1) % stock_watchlist_size());
+  if (stock_watchlist_cycle_timer != NULL)
+  {
+    lv_timer_reset(stock_watchlist_cycle_timer);
+  }
+}
+
+static void on_stock_watchlist_cycle_timer(lv_timer_t *timer)
+{
+  show_stock_watchlist_entry((stock_widget_shown + 1) % stock_watchlist_size());
+}
+
+// Must be called with the lvgl lock held
+static void record_stock_quotes_failed(const std::vector<std::string> &tickers)
+{
+  for (size_t i = 0; i < stock_watchlist_size(); i++)
+  {
+    stock_watchlist_entry *entry = stock_watchlist_entry_at(i);
+    if (std::find(tickers.begin(), tickers.end(), entry->history.ticker) != tickers.end())
+    {
+      stock_watchlist_record_fetch(entry, false);
+    }
+  }
+}
+
+// Must be called with the lvgl lock held
+static void apply_stock_quotes(const std::vector<stock_quote_item> &quotes)
+{
+  for (const stock_quote_item &item : quotes)
+  {
+    for (size_t i = 0; i < stock_watchlist_size(); i++)
+    {
+      stock_watchlist_entry *entry = stock_watchlist_entry_at(i);
+      if (item.ticker == entry->history.ticker)
+      {
+        entry->quote = item.quote;
+        stock_history_set_name(&entry->history, item.name);
+        stock_watchlist_record_fetch(entry, true);
+      }
+    }
+  }
+}
+
+// A fetch the request budget would skip is put off instead of recorded as failed, the shown data did not
+// get any older by it
+static bool is_stock_source_rate_limited(void)
+{
+  return stock_source->is_rate_limited != nullptr && stock_source->is_rate_limited();
+}
+
+static bool refresh_stock_quotes(void)
+{
+  if (is_stock_source_rate_limited())
+  {
+    Serial.println("Stock quotes put off, rate limited");
+    return false;
+  }
+  std::vector<std::string> tickers = stock_watchlist_tickers();
+  auto [is_quotes_valid, quotes] = stock_source->fetch_quotes(tickers);
+  if (!is_quotes_valid)
+  {
+    Serial.println("Refreshing stock quotes failed");
+    lv_lock();
+    record_stock_quotes_failed(tickers);
+    lv_unlock();
+    return false;
+  }
+
+  lv_lock();
+  apply_stock_quotes(quotes);
+  lv_unlock();
+  stock_quotes_fetched_at = time(nullptr);
+  return true;
+}
+
+// The quote of the ticker on screen alone, patched in place when that ticker is still shown
+static bool refresh_live_stock_quote(void)
+{
+  if (is_stock_source_rate_limited())
+  {
+    return false;
+  }
+  size_t index = stock_widget_shown;
+  std::vector<std::string> tickers = {stock_watchlist_entry_at(index)->history.ticker};
+  auto [is_quotes_valid, quotes] = stock_source->fetch_quotes(tickers);
+  if (!is_quotes_valid)
+  {
+    Serial.printf("Refreshing live quote of %s failed\n", tickers[0].c_str());
+    lv_lock();
+    record_stock_quotes_failed(tickers);
+    if (index == stock_widget_shown)
+    {
+      update_stock_widget_live_quote();
+    }
+    lv_unlock();
+    return false;
+  }
+
+  lv_lock();
+  apply_stock_quotes(quotes);
+  if (index == stock_widget_shown)
+  {
+    update_stock_widget_live_quote();
+  }
+  lv_unlock();
+  return true;
+}
+
+static bool refresh_stock_history(size_t index)
+{
+  stock_watchlist_entry *entry = stock_watchlist_entry_at(index);
+  std::string ticker = entry->history.ticker;
+  uint16_t window_start_day = max(get_today_epoch_day() - STOCK_HISTORY_DAYS, 0);
+  uint16_t from_day = stock_history_fetch_from_day(entry->history, window_start_day);
+  auto [is_bars_valid, bars] = stock_source->fetch_bars(ticker, from_day);
+  if (!is_bars_valid)
+  {
+    Serial.printf("Refreshing stock history of %s failed\n", ticker.c_str());
+    lv_lock();
+    stock_watchlist_record_fetch(entry, false);
+    lv_unlock();
+    return false;
+  }
+
+  lv_lock();
+  bool merged = stock_history_merge(&entry->history, bars);
+  bool trimmed = stock_history_trim(&entry->history, window_start_day);
+  entry->history_fetched_at = time(nullptr);
+  stock_watchlist_record_fetch(entry, true);
+  lv_unlock();
+  if (DEBUG_API_REQUESTS)
+  {
+    Serial.printf("Stock history %s: %u bars received from %s, %u cached%s%s\n", ticker.c_str(), bars.size(), epoch_day_to_date_str(from_day).c_str(),
+                  entry->history.series.count, merged ? ", merged" : "", trimmed ? ", trimmed" : "");
+  }
+
+  // Saved even when nothing changed, the saved time is the data age shown after the next boot. Only this
+  // task writes the entry, so it is read without the lock. Other sources leave the cache of the live one
+  if (stock_source->is_live)
+  {
+    stock_history_save(&entry->history);
+  }
+  return true;
+}
+
+// Round robin step over the stale histories, the one on screen first. True when some are still stale
+static bool refresh_stale_stock_histories(void)
+{
+  time_t stale_before = stock_history_stale_before(time(nullptr));
+  for (int i = 0; i < STOCK_HISTORY_REFRESHES_PER_TICK; i++)
+  {
+    if (is_stock_source_rate_limited())
+    {
+      return false;
+    }
+    int index = stock_watchlist_next_stale_history(stock_widget_shown, stale_before);
+    if (index < 0)
+    {
+      return false;
+    }
+    if (!refresh_stock_history(index))
+    {
+      // Leave the rest to the next quote refresh or reconnect instead of retrying every step
+      return false;
+    }
+  }
+  return stock_watchlist_next_stale_history(stock_widget_shown, stale_before) >= 0;
+}
+
+// Starts every entry over with the data of the source, the live one from its flash cache
+static void apply_stock_data_source(const stock_data_source *source)
+{
+  lv_lock();
+  stock_source = source;
+  stock_watchlist_reset(source->is_live);
+  render_stock_watchlist_entry(stock_widget_shown);
+  lv_unlock();
+  stock_quotes_fetched_at = 0;
+  Serial.printf("Stock data source: %s\n", source->name);
+}
+
+static int32_t ms_until(uint32_t due_ms)
+{
+  return max((int32_t)(due_ms - millis()), (int32_t)0);
+}
+
+// Until the market opens, or until the close of the session that just ended has settled
+static uint32_t ms_until_next_market_event(time_t now)
+{
+  time_t event = market_next_open(now);
+  time_t settle = market_last_close(now) + STOCK_CLOSE_SETTLE_S;
+  if (settle > now)
+  {
+    event = min(event, settle);
+  }
+  return (uint32_t)(event - now) * 1000;
+}
+
+// Quotes of the whole watchlist in one request per interval, histories in round robin steps, both followed
+// by a full render. In between, the live quote of the ticker on screen only patches what changed. Woken
+// early by paging to a ticker without history, by the network coming back and by a new data source.
+// With STOCK_MARKET_HOURS that cadence only runs during the session. After the close has settled, one
+// batch of quotes and every history are fetched once, then the task and the radio sleep until the open
+static void stock_watchlist_task_func(void *parameter)
+{
+  uint32_t quotes_due_ms = millis();
+  uint32_t live_quote_due_ms = millis();
+  bool is_history_stale = false;
+  while (true)
+  {
+    const stock_data_source *requested = stock_source_requested;
+    if (requested != nullptr)
+    {
+      stock_source_requested = nullptr;
+      apply_stock_data_source(requested);
+      quotes_due_ms = millis();
+    }
+    uint32_t wait_ms = radio_power_poll_interval_ms(REFRESH_STOCK_QUOTES_FREQ_MS);
+    if ((connectivity_is_online() || !stock_source->is_live) && connectivity_is_clock_valid())
+    {
+      time_t now = time(nullptr);
+      bool is_open = is_stock_market_open(now);
+      // A closed market needs the quotes once after the close, and once at boot
+      bool needs_quotes = is_open || stock_quotes_fetched_at < stock_settled_close(now);
+      // Direct FMP requests are left to the batch, the free tier does not cover a live poll every minute
+      bool is_live_quote_polled = is_open && STOCK_LIVE_QUOTE_MS > 0 && (gateway_enabled() || !stock_source->is_live);
+      uint32_t live_wait_ms = radio_power_poll_interval_ms(STOCK_LIVE_QUOTE_MS);
+      bool is_quotes_due = needs_quotes && ms_until(quotes_due_ms) == 0;
+      if (!is_quotes_due && is_live_quote_polled && ms_until(live_quote_due_ms) == 0)
+      {
+        refresh_live_stock_quote();
+        live_quote_due_ms = millis() + live_wait_ms;
+      }
+      else
+      {
+        if (is_quotes_due)
+        {
+          quotes_due_ms = millis() + (refresh_stock_quotes() ? wait_ms : REFRESH_STOCK_QUOTES_RETRY_MS);
+          // The batch brought the live quote too
+          live_quote_due_ms = millis() + live_wait_ms;
+        }
+        is_history_stale = refresh_stale_stock_histories();
+
+        lv_lock();
+        render_stock_watchlist_entry(stock_widget_shown);
+        lv_unlock();
+      }
+      needs_quotes = is_open || stock_quotes_fetched_at < stock_settled_close(now);
+      wait_ms = needs_quotes ? ms_until(quotes_due_ms) : ms_until_next_market_event(now);
+      if (is_history_stale)
+      {
+        wait_ms = STOCK_HISTORY_ROUND_ROBIN_FREQ_MS;
+      }
+      if (is_live_quote_polled)
+      {
+        wait_ms = min(wait_ms, (uint32_t)ms_until(live_quote_due_ms));
+      }
+    }
+    // The radio wakes for the next fetch only, the task also to follow clock corrections over a long closure
+    radio_power_schedule_wake(STOCK_REFRESH_RADIO_JOB, millis() + wait_ms);
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(min(wait_ms, STOCK_MARKET_RECHECK_MS)));
+  }
+}
+
+static void on_stock_widget_connectivity_changed(connectivity_state state)
+{
+  // Retry a failed refresh as soon as the network is back
+  if (state == CONNECTIVITY_ONLINE && connectivity_is_clock_valid() && stock_watchlist_task != NULL)
+  {
+    xTaskNotifyGive(stock_watchlist_task);
+  }
 }
 
 extern "C" void render_stock_widget(lv_obj_t *parent)
 {
-  load_stock_widget_data();
+  stock_source = stock_data_source_find(STOCK_DATA_SOURCE);
+  if (stock_source == nullptr)
+  {
+    Serial.printf("Unknown stock data source %s, using live\n", STOCK_DATA_SOURCE);
+    stock_source = stock_data_source_find("live");
+  }
+  // Render the last known data immediately, the live data replaces it in the background
+  bool has_watchlist = stock_watchlist_begin(STOCK_WATCHLIST);
+  if (has_watchlist && !stock_source->is_live)
+  {
+    stock_watchlist_reset(false);
+  }
   init_render_stock_widget(parent);
+  if (!has_watchlist)
+  {
+    stock_widget_data.state = STOCK_DATA_ERROR;
+    update_stock_widget_data_age();
+    return;
+  }
+  render_stock_watchlist_entry(0);
+  lv_obj_add_event_cb(chart_range_buttons, on_chart_range_changed, LV_EVENT_VALUE_CHANGED, NULL);
+  lv_obj_add_event_cb(chart_scrub_area, on_chart_scrub, LV_EVENT_PRESSED, NULL);
+  lv_obj_add_event_cb(chart_scrub_area, on_chart_scrub, LV_EVENT_PRESSING, NULL);
+  lv_obj_add_event_cb(chart_scrub_area, on_chart_scrub, LV_EVENT_RELEASED, NULL);
+  lv_obj_add_event_cb(chart_scrub_area, on_chart_scrub, LV_EVENT_PRESS_LOST, NULL);
+  lv_obj_add_event_cb(chart_scrub_area, on_chart_scrub, LV_EVENT_CLICKED, NULL);
+  if (stock_widget_data.state == STOCK_DATA_STALE)
+  {
+    Serial.printf("Rendering cached stock data from %s\n", format_data_age(stock_widget_data.updated_at).c_str());
+  }
+  lv_timer_create(on_stock_widget_data_age_timer, REFRESH_STOCK_WIDGET_DATA_AGE_FREQ_MS, NULL);
+
+  if (stock_watchlist_size() > 1)
+  {
+    lv_obj_add_event_cb(stock_widget_box, on_stock_widget_clicked, LV_EVENT_CLICKED, NULL);
+    if (STOCK_WATCHLIST_CYCLE_MS > 0)
+    {
+      stock_watchlist_cycle_timer = lv_timer_create(on_stock_watchlist_cycle_timer, STOCK_WATCHLIST_CYCLE_MS, NULL);
+    }
+  }
+}
+
+// The first fetch of a source without network renders right away, so the task only starts once setup is
+// done creating the other widgets without the lvgl lock
+extern "C" void start_stock_widget_tasks(void)
+{
+  if (stock_watchlist_task != NULL || stock_watchlist_size() == 0)
+  {
+    return;
+  }
+  xTaskCreate(stock_watchlist_task_func, "StockWatchlist", 8192, NULL, 1, &stock_watchlist_task);
+  connectivity_subscribe(on_stock_widget_connectivity_changed);
 }
\ No newline at end of file
@@ -27,6 +27,15 @@ extern "C"
      * GLOBAL PROTOTYPES
      **********************/
     void render_stock_widget(lv_obj_t *parent=nullptr);
+    void start_stock_widget_tasks(void);
+    void stock_widget_set_chart_candles(bool candles);
+    // Serial diagnostics: how often the chart was redrawn, and the cost of a data update and of a static
+    // frame for the line and the candles
+    void stock_widget_print_chart_stats(void);
+    void stock_widget_bench_chart(void);
+    // Lists the data sources, see stock_data_source.h. Selecting one refetches every ticker from it
+    void stock_widget_print_data_source(void);
+    bool stock_widget_set_data_source(const char *name);
 
     /**********************
      *      MACROS
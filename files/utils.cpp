@@ -5,8 +5,15 @@
 #include <Arduino.h>
 #include <WiFi.h>
 #include <HTTPClient.h>
+#include <WiFiClientSecure.h>
 #include <ArduinoJson.h>
 #include <vector>
+#include "http_policy.h"
+#include "http_inflate.h"
+#include "http_metrics.h"
+#include "json_arena.h"
+#include "radio_power.h"
+#include "config.h"
 
 lv_obj_t* create_lv_div(lv_obj_t* parent)
 {
@@ -29,6 +36,12 @@ time_t get_current_utc_time(void)
     return timeinfo;
 }
 
+bool is_time_valid(time_t time)
+{
+    const time_t MIN_VALID_TIME = 1704067200; // 2024-01-01, anything earlier means the clock is not set yet
+    return time >= MIN_VALID_TIME;
+}
+
 std::string time_span_from_str(std::string *start, std::string *end)
 {
     struct tm start_timeinfo = {0};
@@ -88,46 +101,270 @@ std::string round_float_to_string(float number, int digits)
   return number_str;
 }
 
-std::pair<bool, JsonDocument> send_http_request(const std::string serverEndpoint, const std::string http_method, const std::string payload, const std::vector<std::pair<std::string, std::string>> headers, bool debug_api_requests)
+// Days since 1970-01-01 of a proleptic Gregorian date, see http://howardhinnant.github.io/date_algorithms.html
+static int32_t days_from_civil(int year, int month, int day)
 {
-    // Check WiFi connection status
-    if (WiFi.status() != WL_CONNECTED)
+    year -= month <= 2;
+    int era = (year >= 0 ? year : year - 399) / 400;
+    int year_of_era = year - era * 400;
+    int day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return era * 146097 + day_of_era - 719468;
+}
+
+// Days since 1970-01-01 for a "YYYY-MM-DD" date, 0 if it cannot be parsed
+uint16_t date_str_to_epoch_day(const std::string &date)
+{
+    int year, month, day;
+    if (sscanf(date.c_str(), "%d-%d-%d", &year, &month, &day) != 3)
     {
-        Serial.println("WiFi not connected!");
-        return {false, JsonDocument()};
+        return 0;
+    }
+    return (uint16_t)days_from_civil(year, month, day);
+}
+
+// Like timegm, which newlib does not have, independent of the TZ setting
+time_t utc_datetime_to_time(int year, int month, int day, int hour, int minute, int second)
+{
+    return (time_t)days_from_civil(year, month, day) * 24 * 60 * 60 + hour * 60 * 60 + minute * 60 + second;
+}
+
+std::string epoch_day_to_date_str(uint16_t epoch_day)
+{
+    time_t time = (time_t)epoch_day * 24 * 60 * 60;
+    struct tm timeinfo;
+    gmtime_r(&time, &timeinfo);
+    char buffer[16];
+    strftime(buffer, sizeof(buffer), "%Y-%m-%d", &timeinfo);
+    return std::string(buffer);
+}
+
+uint16_t get_today_epoch_day(void)
+{
+    return time(nullptr) / (24 * 60 * 60);
+}
+
+bool gateway_enabled(void)
+{
+    return GATEWAY_URL[0] != '\0';
+}
+
+static bool url_is_https(const std::string &url)
+{
+    return url.rfind("https://", 0) == 0;
+}
+
+static uint16_t url_port(const std::string &url)
+{
+    size_t start = url.find("://");
+    start = (start == std::string::npos) ? 0 : start + 3;
+    size_t end = url.find_first_of("/?", start);
+    std::string authority = url.substr(start, end == std::string::npos ? std::string::npos : end - start);
+    size_t colon = authority.find(':');
+    if (colon != std::string::npos)
+    {
+        return atoi(authority.c_str() + colon + 1);
     }
+    return url_is_https(url) ? 443 : 80;
+}
+
+static uint16_t elapsed_ms_since(uint32_t started_ms)
+{
+    return min(millis() - started_ms, (uint32_t)HTTP_PHASE_NOT_MEASURED - 1);
+}
 
-    HTTPClient http;
-    http.begin(serverEndpoint.c_str());
-    http.addHeader("Content-Type", "application/json");
-    for (const auto &header : headers)
+std::pair<bool, JsonDocument> send_http_request(const std::string serverEndpoint, const std::string http_method, const std::string payload, const std::vector<std::pair<std::string, std::string>> headers, bool debug_api_requests, const cancel_token *cancel, bool *request_sent)
+{
+    if (request_sent != nullptr)
     {
-        http.addHeader(header.first.c_str(), header.second.c_str());
+        *request_sent = false;
     }
 
-    int httpResponseCode = http.sendRequest(http_method.c_str(), payload.c_str());
-    if (debug_api_requests)
+    // Check WiFi connection status
+    if (WiFi.status() != WL_CONNECTED)
     {
-        Serial.printf("%s, %s\n", http_method.c_str(), serverEndpoint.c_str());
+        Serial.println("WiFi not connected!");
+        return {false, JsonDocument()};
     }
-    if (httpResponseCode > 0)
+
+    radio_power_lock radio_lock; // radio fully awake until the response is read
+    const std::string host = http_policy_host_from_url(serverEndpoint);
+    const std::string endpoint_name = http_metrics_endpoint_name(http_method, serverEndpoint);
+    const bool https = url_is_https(serverEndpoint);
+    const request_context context = make_request_context(HTTP_REQUEST_TIMEOUT_MS, cancel);
+    // A write may have been applied even when its response failed, so only reads are sent twice. Failed DNS
+    // lookups and connects are retried for every method, nothing has gone out then
+    const bool is_idempotent = http_method == "GET";
+    int httpResponseCode = 0;
+    for (int attempt = 0; attempt <= HTTP_RETRY_BUDGET; attempt++)
     {
+        if (attempt > 0)
+        {
+            uint32_t retry_delay_ms = http_policy_retry_delay_ms(host);
+            if (retry_delay_ms >= context.remaining_ms())
+            {
+                Serial.printf("Request to %s given up, no time left to retry\n", host.c_str());
+                return {false, JsonDocument()};
+            }
+            if (debug_api_requests)
+            {
+                Serial.printf("Retry %d/%d for %s in %u ms\n", attempt, HTTP_RETRY_BUDGET, host.c_str(), retry_delay_ms);
+            }
+            context.sleep_ms(retry_delay_ms);
+        }
+        if (context.should_stop())
+        {
+            Serial.printf("Request to %s %s\n", host.c_str(), context.stop_reason());
+            return {false, JsonDocument()};
+        }
+
+        http_policy_decision decision = http_policy_acquire(host);
+        if (decision != HTTP_POLICY_ALLOW)
+        {
+            Serial.printf("Request to %s skipped: %s\n", host.c_str(), http_policy_decision_str(decision));
+            return {false, JsonDocument()};
+        }
+
+        http_request_sample sample = http_metrics_new_sample();
+        sample.rssi = WiFi.RSSI();
+        auto record_sample = [&](http_error_kind error)
+        {
+            sample.error = error;
+            sample.http_code = httpResponseCode;
+            http_metrics_record(host, endpoint_name, sample);
+        };
+
+        // Resolve and connect ourselves so each phase can be timed, HTTPClient then reuses the open connection
+        uint32_t phase_started_ms = millis();
+        IPAddress address;
+        if (!WiFi.hostByName(host.c_str(), address))
+        {
+            httpResponseCode = HTTPC_ERROR_CONNECTION_REFUSED;
+            http_policy_report(host, httpResponseCode);
+            record_sample(HTTP_ERROR_DNS);
+            Serial.printf("DNS lookup for %s failed\n", host.c_str());
+            continue;
+        }
+        sample.phase_ms[HTTP_PHASE_DNS] = elapsed_ms_since(phase_started_ms);
+
+        WiFiClient plain_client;
+        WiFiClientSecure secure_client;
+        phase_started_ms = millis();
+        bool connected;
+        if (https)
+        {
+            // The 2.x secure client opens the socket and handshakes in one call, so tls includes the tcp connect
+            secure_client.setInsecure();
+            secure_client.setHandshakeTimeout((context.remaining_ms() + 999) / 1000);
+            connected = secure_client.connect(host.c_str(), url_port(serverEndpoint), context.remaining_ms());
+        }
+        else
+        {
+            connected = plain_client.connect(address, url_port(serverEndpoint), context.remaining_ms());
+        }
+        if (!connected)
+        {
+            httpResponseCode = HTTPC_ERROR_CONNECTION_REFUSED;
+            http_policy_report(host, httpResponseCode);
+            record_sample(HTTP_ERROR_CONNECT);
+            Serial.printf("Connecting to %s failed\n", host.c_str());
+            continue;
+        }
+        sample.phase_ms[https ? HTTP_PHASE_TLS : HTTP_PHASE_TCP] = elapsed_ms_since(phase_started_ms);
+
+        WiFiClient *client = https ? &secure_client : &plain_client;
+        HTTPClient http;
+        http.begin(*client, serverEndpoint.c_str());
+        // Every read is bounded by what is left of the deadline
+        http.setTimeout(min(context.remaining_ms(), (uint32_t)UINT16_MAX));
+        // HTTP/1.0 rules out chunked transfer coding, so the body can be parsed straight off the socket
+        http.useHTTP10(true);
+        http.addHeader("Content-Type", "application/json");
+#if HTTP_ACCEPT_COMPRESSION
+        http.addHeader("Accept-Encoding", "gzip, deflate");
+#endif
+        const char *response_headers[] = {"Content-Encoding", "Content-Type"};
+        http.collectHeaders(response_headers, 2);
+        for (const auto &header : headers)
+        {
+            http.addHeader(header.first.c_str(), header.second.c_str());
+        }
+
+        if (request_sent != nullptr)
+        {
+            *request_sent = true;
+        }
+        phase_started_ms = millis();
+        httpResponseCode = http.sendRequest(http_method.c_str(), payload.c_str());
+        sample.phase_ms[HTTP_PHASE_TTFB] = elapsed_ms_since(phase_started_ms);
+        http_policy_report(host, httpResponseCode);
+        if (debug_api_requests)
+        {
+            Serial.printf("%s, %s\n", http_method.c_str(), serverEndpoint.c_str());
+        }
+        if (context.should_stop())
+        {
+            Serial.printf("Request to %s %s after the headers\n", host.c_str(), context.stop_reason());
+            record_sample(HTTP_ERROR_BODY);
+            http.end();
+            return {false, JsonDocument()};
+        }
+        if (http_policy_is_retryable(httpResponseCode))
+        {
+            Serial.printf("HTTP Error code: %d\n", httpResponseCode);
+            record_sample(HTTP_ERROR_STATUS);
+            http.end();
+            if (!is_idempotent)
+            {
+                return {false, JsonDocument()};
+            }
+            continue;
+        }
+
         if (debug_api_requests)
         {
             Serial.printf("HTTP Response code: %d\n", httpResponseCode);
         }
-        String payload = http.getString();
+        http_content_encoding encoding = http_content_encoding_from_header(http.header("Content-Encoding"));
+        inflate_stream body(http.getStream(), encoding, &context);
+        // The gateway answers in MessagePack, the APIs in JSON
+        String content_type = http.header("Content-Type");
+        bool is_msgpack = content_type.startsWith("application/msgpack") || content_type.startsWith("application/x-msgpack");
+        // The document lives in a PSRAM arena that rewinds once the caller drops it
+        json_arena *arena = json_arena_acquire();
+        JsonDocument doc(arena);
+        phase_started_ms = millis();
+        DeserializationError error = is_msgpack ? deserializeMsgPack(doc, body) : deserializeJson(doc, body);
+        bool body_ok = body.finish();
+        sample.json_bytes = arena->high_water();
+        json_arena_release(arena);
+        // Parsing pulls the body off the socket, so split the time into waiting on the radio and our own work
+        uint32_t decode_ms = millis() - phase_started_ms;
+        sample.phase_ms[HTTP_PHASE_BODY] = min(body.read_us() / 1000, decode_ms);
+        sample.phase_ms[HTTP_PHASE_PARSE] = decode_ms - sample.phase_ms[HTTP_PHASE_BODY];
+        http_transfer_record(encoding, body.wire_bytes(), body.body_bytes(), body.inflate_us());
 
         if (debug_api_requests)
         {
-            //Serial.printf("Payload: %s\n", payload.c_str());
+            Serial.printf("Body %s: %u bytes received, %u bytes of %s, inflated in %u us\n", http_content_encoding_str(encoding),
+                          body.wire_bytes(), body.body_bytes(), is_msgpack ? "MessagePack" : "JSON", body.inflate_us());
+            Serial.printf("Timing %s: dns %u ms, %s %u ms, ttfb %u ms, body %u ms, parse %u ms, rssi %d dBm, json %u bytes\n", endpoint_name.c_str(),
+                          sample.phase_ms[HTTP_PHASE_DNS], https ? "tls" : "tcp", sample.phase_ms[https ? HTTP_PHASE_TLS : HTTP_PHASE_TCP],
+                          sample.phase_ms[HTTP_PHASE_TTFB], sample.phase_ms[HTTP_PHASE_BODY], sample.phase_ms[HTTP_PHASE_PARSE], sample.rssi,
+                          sample.json_bytes);
         }
-        JsonDocument doc;
-        DeserializationError error = deserializeJson(doc, payload);
 
         if (error)
         {
-            Serial.printf("JSON parsing failed: %s\n", error.c_str());
+            Serial.printf("%s parsing failed: %s\n", is_msgpack ? "MessagePack" : "JSON", error.c_str());
+            record_sample(body_ok ? HTTP_ERROR_PARSE : HTTP_ERROR_BODY);
+            http.end();
+            return {false, JsonDocument()};
+        }
+
+        if (!body_ok)
+        {
+            record_sample(HTTP_ERROR_BODY);
             http.end();
             return {false, JsonDocument()};
         }
@@ -135,17 +372,14 @@ std::pair<bool, JsonDocument> send_http_request(const std::string serverEndpoint
         if (doc.isNull())
         {
             Serial.println("doc is null!");
+            record_sample(HTTP_ERROR_PARSE);
             http.end();
             return {false, JsonDocument()};
         }
 
+        record_sample(httpResponseCode >= 400 ? HTTP_ERROR_STATUS : HTTP_ERROR_NONE);
         http.end();
-        return {true, doc};
+        return {true, std::move(doc)};
     }
-    else
-    {
-        Serial.printf("HTTP Error code: %d\n", httpResponseCode);
-        http.end();
-        return {false, JsonDocument()};
-    }
-}
\ No newline at end of file
+    return {false, JsonDocument()};
+}
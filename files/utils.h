@@ -5,9 +5,18 @@
 #include <vector>
 #include <ctime>
 #include <ArduinoJson.h>
+#include "request_context.h"
 
 lv_obj_t* create_lv_div(lv_obj_t* parent);
 time_t get_current_utc_time(void);
+bool is_time_valid(time_t time);
 std::string time_span_from_str(std::string *start, std::string *end);
 std::string round_float_to_string(float number, int digits);
-std::pair<bool, JsonDocument> send_http_request(const std::string serverEndpoint, const std::string http_method, const std::string payload="", const std::vector<std::pair<std::string, std::string>> headers={}, bool debug_api_requests=false);
+uint16_t date_str_to_epoch_day(const std::string &date);
+std::string epoch_day_to_date_str(uint16_t epoch_day);
+uint16_t get_today_epoch_day(void);
+time_t utc_datetime_to_time(int year, int month, int day, int hour, int minute, int second);
+bool gateway_enabled(void);
+// request_sent is left false when no attempt got as far as sending the request, a write that failed then was
+// certainly not applied
+std::pair<bool, JsonDocument> send_http_request(const std::string serverEndpoint, const std::string http_method, const std::string payload="", const std::vector<std::pair<std::string, std::string>> headers={}, bool debug_api_requests=false, const cancel_token *cancel=nullptr, bool *request_sent=nullptr);
@@ -0,0 +1,308 @@
+#include <Arduino.h>
+#include <Preferences.h>
+#include <SPIFFS.h>
+#include <nvs.h>
+#include "widget_state_store.h"
+#include "utils.h"
+
+const char *WIDGET_STATE_NAMESPACE = "widget_state";
+const size_t WIDGET_STATE_HEADER_SIZE = 5; // version u8 + saved_at u32
+
+void state_writer::write_u8(uint8_t value)
+{
+    buffer.push_back(value);
+}
+
+void state_writer::write_u16(uint16_t value)
+{
+    buffer.push_back(value & 0xff);
+    buffer.push_back(value >> 8);
+}
+
+void state_writer::write_u32(uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        buffer.push_back((value >> (8 * i)) & 0xff);
+    }
+}
+
+void state_writer::write_i32(int32_t value)
+{
+    write_u32((uint32_t)value);
+}
+
+void state_writer::write_float(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    write_u32(bits);
+}
+
+void state_writer::write_string(const std::string &value)
+{
+    size_t length = value.size() > UINT16_MAX ? UINT16_MAX : value.size();
+    write_u16(length);
+    buffer.insert(buffer.end(), value.begin(), value.begin() + length);
+}
+
+uint8_t state_reader::read_u8()
+{
+    if (!ok || pos + 1 > size)
+    {
+        ok = false;
+        return 0;
+    }
+    return data[pos++];
+}
+
+uint16_t state_reader::read_u16()
+{
+    uint16_t low = read_u8();
+    uint16_t high = read_u8();
+    return low | (high << 8);
+}
+
+uint32_t state_reader::read_u32()
+{
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        value |= (uint32_t)read_u8() << (8 * i);
+    }
+    return value;
+}
+
+int32_t state_reader::read_i32()
+{
+    return (int32_t)read_u32();
+}
+
+float state_reader::read_float()
+{
+    uint32_t bits = read_u32();
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+std::string state_reader::read_string()
+{
+    size_t length = read_u16();
+    if (!ok || pos + length > size)
+    {
+        ok = false;
+        return "";
+    }
+    std::string value((const char *)data + pos, length);
+    pos += length;
+    return value;
+}
+
+static state_writer make_state_record(uint8_t version, const state_writer &writer)
+{
+    state_writer record;
+    record.buffer.reserve(WIDGET_STATE_HEADER_SIZE + writer.buffer.size());
+    record.write_u8(version);
+    record.write_u32((uint32_t)time(nullptr));
+    record.buffer.insert(record.buffer.end(), writer.buffer.begin(), writer.buffer.end());
+    return record;
+}
+
+static std::pair<bool, stored_widget_state> parse_state_record(const char *key, uint8_t version, const std::vector<uint8_t> &record)
+{
+    if (record.size() < WIDGET_STATE_HEADER_SIZE)
+    {
+        return {false, {}};
+    }
+    state_reader reader = {.data = record.data(), .size = record.size()};
+    if (reader.read_u8() != version)
+    {
+        Serial.printf("Widget state %s has an old format, ignoring it\n", key);
+        return {false, {}};
+    }
+    stored_widget_state state = {
+        .saved_at = (time_t)reader.read_u32(),
+        .payload = std::vector<uint8_t>(record.begin() + WIDGET_STATE_HEADER_SIZE, record.end()),
+    };
+    return {true, state};
+}
+
+bool save_widget_state(const char *key, uint8_t version, const state_writer &writer)
+{
+    state_writer record = make_state_record(version, writer);
+
+    Preferences preferences;
+    if (!preferences.begin(WIDGET_STATE_NAMESPACE, false))
+    {
+        Serial.println("Failed to open widget state storage");
+        return false;
+    }
+    size_t written = preferences.putBytes(key, record.buffer.data(), record.buffer.size());
+    preferences.end();
+
+    if (written != record.buffer.size())
+    {
+        Serial.printf("Failed to save widget state %s\n", key);
+        return false;
+    }
+    return true;
+}
+
+std::pair<bool, stored_widget_state> load_widget_state(const char *key, uint8_t version)
+{
+    Preferences preferences;
+    if (!preferences.begin(WIDGET_STATE_NAMESPACE, true))
+    {
+        return {false, {}};
+    }
+
+    std::vector<uint8_t> record(preferences.getBytesLength(key));
+    if (record.size() < WIDGET_STATE_HEADER_SIZE)
+    {
+        preferences.end();
+        return {false, {}};
+    }
+    preferences.getBytes(key, record.data(), record.size());
+    preferences.end();
+
+    return parse_state_record(key, version, record);
+}
+
+void erase_widget_states_with_prefix(const char *prefix)
+{
+    // Keys are collected first, the nvs iterator must not see the erases
+    std::vector<std::string> keys;
+    nvs_iterator_t iterator = nvs_entry_find(NVS_DEFAULT_PART_NAME, WIDGET_STATE_NAMESPACE, NVS_TYPE_BLOB);
+    while (iterator != NULL)
+    {
+        nvs_entry_info_t info;
+        nvs_entry_info(iterator, &info);
+        if (strncmp(info.key, prefix, strlen(prefix)) == 0)
+        {
+            keys.push_back(info.key);
+        }
+        iterator = nvs_entry_next(iterator);
+    }
+    nvs_release_iterator(iterator);
+    if (keys.empty())
+    {
+        return;
+    }
+
+    Preferences preferences;
+    if (!preferences.begin(WIDGET_STATE_NAMESPACE, false))
+    {
+        return;
+    }
+    for (const std::string &key : keys)
+    {
+        preferences.remove(key.c_str());
+    }
+    preferences.end();
+    Serial.printf("Erased %u widget states %s* from NVS\n", keys.size(), prefix);
+}
+
+// Mounted on first use, an unformatted partition is formatted then
+static bool mount_widget_state_files(void)
+{
+    static bool mounted = false;
+    if (!mounted)
+    {
+        mounted = SPIFFS.begin(true);
+        if (!mounted)
+        {
+            Serial.println("Failed to mount the widget state file system");
+        }
+    }
+    return mounted;
+}
+
+bool save_widget_state_file(const char *path, uint8_t version, const state_writer &writer)
+{
+    if (!mount_widget_state_files())
+    {
+        return false;
+    }
+    state_writer record = make_state_record(version, writer);
+
+    // Written next to the old file and renamed over it. A reset while writing keeps the old file, a reset
+    // between the remove and the rename leaves only the new one, which the next load renames into place
+    std::string temporary_path = std::string(path) + "~";
+    File file = SPIFFS.open(temporary_path.c_str(), FILE_WRITE);
+    if (!file)
+    {
+        Serial.printf("Failed to open widget state %s\n", path);
+        return false;
+    }
+    size_t written = file.write(record.buffer.data(), record.buffer.size());
+    file.close();
+
+    if (written != record.buffer.size())
+    {
+        Serial.printf("Failed to save widget state %s\n", path);
+        SPIFFS.remove(temporary_path.c_str());
+        return false;
+    }
+    SPIFFS.remove(path);
+    return SPIFFS.rename(temporary_path.c_str(), path);
+}
+
+std::pair<bool, stored_widget_state> load_widget_state_file(const char *path, uint8_t version)
+{
+    if (!mount_widget_state_files())
+    {
+        return {false, {}};
+    }
+    if (!SPIFFS.exists(path))
+    {
+        std::string temporary_path = std::string(path) + "~";
+        if (!SPIFFS.exists(temporary_path.c_str()) || !SPIFFS.rename(temporary_path.c_str(), path))
+        {
+            return {false, {}};
+        }
+        Serial.printf("Recovered widget state %s from an interrupted save\n", path);
+    }
+    File file = SPIFFS.open(path, FILE_READ);
+    if (!file)
+    {
+        return {false, {}};
+    }
+    std::vector<uint8_t> record(file.size());
+    size_t read = file.read(record.data(), record.size());
+    file.close();
+    if (read != record.size())
+    {
+        return {false, {}};
+    }
+    return parse_state_record(path, version, record);
+}
+
+std::string format_data_age(time_t saved_at)
+{
+    time_t now = time(nullptr);
+    if (!is_time_valid(now) || !is_time_valid(saved_at) || now < saved_at)
+    {
+        return "cached";
+    }
+
+    long age = now - saved_at;
+    char buffer[32];
+    if (age < 60)
+    {
+        snprintf(buffer, sizeof(buffer), "just now");
+    }
+    else if (age < 60 * 60)
+    {
+        snprintf(buffer, sizeof(buffer), "%ldm ago", age / 60);
+    }
+    else if (age < 24 * 60 * 60)
+    {
+        snprintf(buffer, sizeof(buffer), "%ldh ago", age / (60 * 60));
+    }
+    else
+    {
+        snprintf(buffer, sizeof(buffer), "%ldd ago", age / (24 * 60 * 60));
+    }
+    return std::string(buffer);
+}
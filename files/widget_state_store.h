@@ -0,0 +1,49 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <ctime>
+#include <cstdint>
+
+// Compact little-endian binary encoding for widget data persisted to NVS
+struct state_writer
+{
+    std::vector<uint8_t> buffer;
+
+    void write_u8(uint8_t value);
+    void write_u16(uint16_t value);
+    void write_u32(uint32_t value);
+    void write_i32(int32_t value);
+    void write_float(float value);
+    void write_string(const std::string &value); // u16 length prefix
+};
+
+struct state_reader
+{
+    const uint8_t *data;
+    size_t size;
+    size_t pos = 0;
+    bool ok = true; // false after any read past the end, values read after that are zero
+
+    uint8_t read_u8();
+    uint16_t read_u16();
+    uint32_t read_u32();
+    int32_t read_i32();
+    float read_float();
+    std::string read_string();
+};
+
+struct stored_widget_state
+{
+    time_t saved_at;
+    std::vector<uint8_t> payload;
+};
+
+bool save_widget_state(const char *key, uint8_t version, const state_writer &writer);
+std::pair<bool, stored_widget_state> load_widget_state(const char *key, uint8_t version);
+// Removes the NVS states whose key starts with prefix, for states that moved elsewhere
+void erase_widget_states_with_prefix(const char *prefix);
+// The same records as files on the SPIFFS partition, for states too large for NVS
+bool save_widget_state_file(const char *path, uint8_t version, const state_writer &writer);
+std::pair<bool, stored_widget_state> load_widget_state_file(const char *path, uint8_t version);
+std::string format_data_age(time_t saved_at);
@@ -0,0 +1,373 @@
+#!/usr/bin/env python3
+"""Local aggregation gateway for the dashboard widgets.
+
+Polls Clockify and Financial Modeling Prep on behalf of the device, reduces the
+responses to exactly what the widgets display and serves them as one small
+MessagePack document per widget refresh. The device then makes a single plain
+HTTP request on the LAN instead of TLS requests to every API. Build the
+firmware with
+
+    '-D GATEWAY_URL="http://<host>:8090"'
+
+in private_config.ini to use it; the device falls back to the APIs when the
+gateway cannot be reached.
+
+Routes:
+    GET  /v1/stock?symbol=TSLA   stock document, symbols are polled from their first request on
+                                 &from=<epoch day> keeps only the bars from that day on
+    GET  /v1/quotes?symbols=TSLA,AAPL   latest quotes of the symbols in one document
+    GET  /v1/clockify            clockify document
+    POST /v1/clockify/stop       stops the running time entry, answers with the clockify document
+    POST /v1/clockify/start      starts an entry from {"description", "projectId"}, same answer
+    GET  /v1/health              polling status as JSON
+Add ?format=json to any route to read the document as JSON.
+
+Examples:
+    CLOCKIFY_API_KEY=... STOCK_API_KEY=... python3 gateway_server.py --symbols TSLA
+    python3 gateway_server.py --clockify-base-url http://localhost:8080/api/v1 \\
+        --stock-base-url http://localhost:8080/stable --clockify-api-key x --stock-api-key x
+"""
+
+import argparse
+import datetime
+import json
+import os
+import struct
+import threading
+import time
+import urllib.error
+import urllib.parse
+import urllib.request
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+EPOCH = datetime.date(1970, 1, 1)
+
+
+def msgpack_encode(obj):
+    """MessagePack encoder for the JSON data model, floats are sent as float32."""
+    if obj is None:
+        return b"\xc0"
+    if obj is True:
+        return b"\xc3"
+    if obj is False:
+        return b"\xc2"
+    if isinstance(obj, int):
+        if 0 <= obj < 0x80:
+            return struct.pack("B", obj)
+        if -32 <= obj < 0:
+            return struct.pack("b", obj)
+        if 0 <= obj <= 0xFF:
+            return b"\xcc" + struct.pack("B", obj)
+        if 0 <= obj <= 0xFFFF:
+            return b"\xcd" + struct.pack(">H", obj)
+        if 0 <= obj <= 0xFFFFFFFF:
+            return b"\xce" + struct.pack(">I", obj)
+        if obj >= 0:
+            return b"\xcf" + struct.pack(">Q", obj)
+        if obj >= -0x80:
+            return b"\xd0" + struct.pack("b", obj)
+        if obj >= -0x8000:
+            return b"\xd1" + struct.pack(">h", obj)
+        if obj >= -0x80000000:
+            return b"\xd2" + struct.pack(">i", obj)
+        return b"\xd3" + struct.pack(">q", obj)
+    if isinstance(obj, float):
+        return b"\xca" + struct.pack(">f", obj)
+    if isinstance(obj, str):
+        data = obj.encode("utf-8")
+        if len(data) < 32:
+            return struct.pack("B", 0xA0 | len(data)) + data
+        if len(data) <= 0xFF:
+            return b"\xd9" + struct.pack("B", len(data)) + data
+        if len(data) <= 0xFFFF:
+            return b"\xda" + struct.pack(">H", len(data)) + data
+        return b"\xdb" + struct.pack(">I", len(data)) + data
+    if isinstance(obj, (list, tuple)):
+        if len(obj) < 16:
+            header = struct.pack("B", 0x90 | len(obj))
+        elif len(obj) <= 0xFFFF:
+            header = b"\xdc" + struct.pack(">H", len(obj))
+        else:
+            header = b"\xdd" + struct.pack(">I", len(obj))
+        return header + b"".join(msgpack_encode(item) for item in obj)
+    if isinstance(obj, dict):
+        if len(obj) < 16:
+            header = struct.pack("B", 0x80 | len(obj))
+        elif len(obj) <= 0xFFFF:
+            header = b"\xde" + struct.pack(">H", len(obj))
+        else:
+            header = b"\xdf" + struct.pack(">I", len(obj))
+        return header + b"".join(msgpack_encode(str(k)) + msgpack_encode(v) for k, v in obj.items())
+    raise TypeError(f"Cannot encode {type(obj).__name__} as MessagePack")
+
+
+def utc_now_str():
+    return datetime.datetime.now(datetime.timezone.utc).strftime("%Y-%m-%dT%H:%M:%SZ")
+
+
+def epoch_day(date_str):
+    return (datetime.date.fromisoformat(date_str[:10]) - EPOCH).days
+
+
+class Upstream:
+    """Blocking JSON requests to the third-party APIs."""
+
+    def __init__(self, options):
+        self.options = options
+
+    def request(self, url, method="GET", body=None, headers=None):
+        data = json.dumps(body).encode("utf-8") if body is not None else None
+        request = urllib.request.Request(url, data=data, method=method, headers=dict(headers or {}, **{"Content-Type": "application/json"}))
+        with urllib.request.urlopen(request, timeout=self.options.timeout) as response:
+            payload = response.read()
+        return json.loads(payload) if payload else None
+
+    def clockify(self, path, method="GET", body=None):
+        return self.request(self.options.clockify_base_url + path, method, body, {"x-api-key": self.options.clockify_api_key})
+
+    def stock_history(self, symbol):
+        since = (datetime.date.today() - datetime.timedelta(days=self.options.history_days)).isoformat()
+        query = urllib.parse.urlencode({"symbol": symbol, "apikey": self.options.stock_api_key, "from": since})
+        return self.request(f"{self.options.stock_base_url}/historical-price-eod/full?{query}")
+
+    def stock_quotes(self, symbols):
+        query = urllib.parse.urlencode({"symbols": ",".join(symbols), "apikey": self.options.stock_api_key})
+        return self.request(f"{self.options.stock_base_url}/batch-quote?{query}")
+
+
+def clockify_entry(entry):
+    interval = entry.get("timeInterval") or {}
+    return {
+        "id": entry.get("id") or "",
+        "description": entry.get("description") or "",
+        "project_id": entry.get("projectId") or "",
+        "start": interval.get("start") or "",
+        "end": interval.get("end") or "",
+        "duration": interval.get("duration") or "",
+    }
+
+
+class Gateway:
+    """Polls the APIs in the background and keeps the latest widget documents."""
+
+    def __init__(self, options):
+        self.options = options
+        self.upstream = Upstream(options)
+        self.lock = threading.Lock()
+        self.user = None
+        self.clockify_doc = None
+        self.clockify_due = 0.0
+        self.stock_docs = {}
+        self.stock_due = {symbol: 0.0 for symbol in options.symbols}
+        self.quotes = {}  # symbol -> (fetched monotonic time, [symbol, name, price, change, percent change])
+        self.errors = {}
+
+    def time_entries_path(self):
+        return f"/workspaces/{self.user['workspace_id']}/user/{self.user['id']}/time-entries"
+
+    def refresh_clockify(self):
+        if self.user is None:
+            user = self.upstream.clockify("/user")
+            self.user = {
+                "id": user["id"],
+                "workspace_id": user["activeWorkspace"],
+                "time_zone": (user.get("settings") or {}).get("timeZone") or "",
+            }
+        path = self.time_entries_path()
+        in_progress = self.upstream.clockify(path + "?in-progress=true&page-size=1")
+        entries = self.upstream.clockify(path + f"?in-progress=false&page-size={self.options.entries}")
+        doc = {
+            "updated": int(time.time()),
+            "user": self.user,
+            "in_progress": clockify_entry(in_progress[0]) if in_progress else None,
+            "entries": [clockify_entry(e) for e in entries],
+        }
+        with self.lock:
+            self.clockify_doc = doc
+        return doc
+
+    def refresh_stock(self, symbol):
+        history = self.upstream.stock_history(symbol)
+        # newest first, the order the widget expects
+        bars = [[epoch_day(bar["date"]), float(bar["open"]), float(bar["close"]),
+                 float(bar.get("high") or 0), float(bar.get("low") or 0), int(bar.get("volume") or 0)] for bar in history]
+        doc = {"updated": int(time.time()), "symbol": symbol, "bars": bars}
+        with self.lock:
+            self.stock_docs[symbol] = doc
+        return doc
+
+    def run_job(self, name, job, *args):
+        try:
+            job(*args)
+            self.errors.pop(name, None)
+            return True
+        except (urllib.error.URLError, OSError, ValueError, KeyError, TypeError) as error:
+            self.errors[name] = str(error)
+            print(f"{name}: {error}")
+            return False
+
+    def poll_forever(self):
+        while True:
+            now = time.monotonic()
+            if now >= self.clockify_due:
+                self.run_job("clockify", self.refresh_clockify)
+                self.clockify_due = now + self.options.clockify_interval
+            for symbol, due in list(self.stock_due.items()):
+                if now >= due:
+                    self.run_job(f"stock {symbol}", self.refresh_stock, symbol)
+                    self.stock_due[symbol] = now + self.options.stock_interval
+            time.sleep(0.5)
+
+    def stock(self, symbol):
+        with self.lock:
+            doc = self.stock_docs.get(symbol)
+        if doc is None:
+            # First request for this symbol, fetch it now and keep polling it from then on
+            self.stock_due.setdefault(symbol, time.monotonic() + self.options.stock_interval)
+            self.run_job(f"stock {symbol}", self.refresh_stock, symbol)
+            with self.lock:
+                doc = self.stock_docs.get(symbol)
+        return doc
+
+    def quotes_doc(self, symbols):
+        # Quotes are fetched on demand, the symbols missing or older than --quote-interval in one upstream request
+        now = time.monotonic()
+        with self.lock:
+            stale = [s for s in symbols if s not in self.quotes or now - self.quotes[s][0] >= self.options.quote_interval]
+        if stale:
+            quotes = self.upstream.stock_quotes(stale)
+            with self.lock:
+                for quote in quotes:
+                    row = [quote["symbol"], quote.get("name") or "", float(quote.get("price") or 0),
+                           float(quote.get("change") or 0), float(quote.get("changePercentage") or 0),
+                           int(quote.get("timestamp") or 0)]
+                    self.quotes[quote["symbol"]] = (now, row)
+        with self.lock:
+            return {"updated": int(time.time()), "quotes": [self.quotes[s][1] for s in symbols if s in self.quotes]}
+
+    def clockify(self):
+        with self.lock:
+            return self.clockify_doc
+
+    def clockify_write(self, method, body):
+        if self.user is None:
+            self.refresh_clockify()
+        self.upstream.clockify(self.time_entries_path(), method, body)
+        self.clockify_due = time.monotonic() + self.options.clockify_interval
+        return self.refresh_clockify()
+
+    def health(self):
+        with self.lock:
+            return {
+                "clockify_updated": self.clockify_doc["updated"] if self.clockify_doc else None,
+                "stock_updated": {symbol: doc["updated"] for symbol, doc in self.stock_docs.items()},
+                "errors": dict(self.errors),
+            }
+
+
+class GatewayHandler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+    options = None
+    gateway = None
+
+    def log_message(self, fmt, *args):
+        if not self.options.quiet:
+            super().log_message(fmt, *args)
+
+    def do_GET(self):
+        url = urllib.parse.urlsplit(self.path)
+        query = urllib.parse.parse_qs(url.query)
+        if url.path == "/v1/stock":
+            symbol = query.get("symbol", [self.options.symbols[0]])[0].upper()
+            doc = self.gateway.stock(symbol)
+            if doc is not None and query.get("from", [""])[0].isdigit():
+                # The device caches the history and only asks for the bars it does not have yet
+                from_day = int(query["from"][0])
+                doc = dict(doc, bars=[bar for bar in doc["bars"] if bar[0] >= from_day])
+            self.send_document(doc, query)
+        elif url.path == "/v1/quotes":
+            symbols = [s.strip().upper() for s in query.get("symbols", [""])[0].split(",") if s.strip()]
+            try:
+                self.send_document(self.gateway.quotes_doc(symbols), query)
+            except (urllib.error.URLError, OSError, ValueError, KeyError, TypeError) as error:
+                self.send_document({"error": str(error)}, query, 502)
+        elif url.path == "/v1/clockify":
+            self.send_document(self.gateway.clockify(), query)
+        elif url.path == "/v1/health":
+            self.send_document(self.gateway.health(), {"format": ["json"]})
+        else:
+            self.send_document({"error": f"No route for GET {url.path}"}, query, 404)
+
+    def do_POST(self):
+        url = urllib.parse.urlsplit(self.path)
+        query = urllib.parse.parse_qs(url.query)
+        length = int(self.headers.get("Content-Length", 0))
+        body = json.loads(self.rfile.read(length) or b"{}") if length > 0 else {}
+        try:
+            if url.path == "/v1/clockify/stop":
+                doc = self.gateway.clockify_write("PATCH", {"end": utc_now_str()})
+            elif url.path == "/v1/clockify/start":
+                entry = {"description": body.get("description", ""), "start": utc_now_str(), "type": "REGULAR"}
+                if body.get("projectId"):
+                    entry["projectId"] = body["projectId"]
+                doc = self.gateway.clockify_write("POST", entry)
+            else:
+                self.send_document({"error": f"No route for POST {url.path}"}, query, 404)
+                return
+        except urllib.error.HTTPError as error:
+            self.send_document({"error": f"Clockify answered {error.code}"}, query, 502)
+            return
+        except (urllib.error.URLError, OSError, ValueError, KeyError) as error:
+            self.send_document({"error": str(error)}, query, 502)
+            return
+        self.send_document(doc, query)
+
+    def send_document(self, doc, query, status=200):
+        if doc is None:
+            status, doc = 503, {"error": "No data yet"}
+        if query.get("format", [""])[0] == "json":
+            payload, content_type = json.dumps(doc).encode("utf-8"), "application/json"
+        else:
+            payload, content_type = msgpack_encode(doc), "application/msgpack"
+        self.send_response(status)
+        self.send_header("Content-Type", content_type)
+        self.send_header("Content-Length", str(len(payload)))
+        self.end_headers()
+        self.wfile.write(payload)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--host", default="0.0.0.0")
+    parser.add_argument("--port", type=int, default=8090)
+    parser.add_argument("--clockify-api-key", default=os.environ.get("CLOCKIFY_API_KEY", ""))
+    parser.add_argument("--stock-api-key", default=os.environ.get("STOCK_API_KEY", ""))
+    parser.add_argument("--clockify-base-url", default="https://api.clockify.me/api/v1")
+    parser.add_argument("--stock-base-url", default="https://financialmodelingprep.com/stable")
+    parser.add_argument("--symbols", default="TSLA", help="comma separated tickers polled from the start")
+    parser.add_argument("--clockify-interval", type=float, default=5, help="seconds between Clockify polls")
+    parser.add_argument("--stock-interval", type=float, default=900, help="seconds between stock history polls")
+    parser.add_argument("--quote-interval", type=float, default=60, help="seconds a quote is served before it is fetched again")
+    parser.add_argument("--history-days", type=int, default=1826, help="days of daily bars polled per symbol")
+    parser.add_argument("--entries", type=int, default=5, help="recent time entries in the clockify document")
+    parser.add_argument("--timeout", type=float, default=15, help="upstream request timeout in seconds")
+    parser.add_argument("--quiet", action="store_true")
+    options = parser.parse_args()
+    options.symbols = [s.strip().upper() for s in options.symbols.split(",") if s.strip()]
+    if not options.clockify_api_key or not options.stock_api_key:
+        parser.error("the Clockify and stock API keys are required, as options or CLOCKIFY_API_KEY/STOCK_API_KEY")
+
+    gateway = Gateway(options)
+    threading.Thread(target=gateway.poll_forever, daemon=True).start()
+    GatewayHandler.options = options
+    GatewayHandler.gateway = gateway
+    server = ThreadingHTTPServer((options.host, options.port), GatewayHandler)
+    print(f"Gateway serving on http://{options.host}:{options.port}")
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
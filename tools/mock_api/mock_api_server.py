@@ -0,0 +1,306 @@
+#!/usr/bin/env python3
+"""Local stand-in for the Clockify and Financial Modeling Prep APIs.
+
+Serves the recorded payloads in fixtures/ so the firmware network paths can be
+exercised and benchmarked without API keys. Build the firmware with
+
+    '-D CLOCKIFY_API_BASE_URL="http://<host>:8080/api/v1"'
+    '-D STOCK_API_BASE_URL="http://<host>:8080/stable"'
+
+in private_config.ini to point it here.
+
+Examples:
+    python3 mock_api_server.py                          # replay fixtures
+    python3 mock_api_server.py --latency-ms 300 --bandwidth 20000
+    python3 mock_api_server.py --error-rate 0.2 --error-code 503
+    python3 mock_api_server.py --scale 12               # ~1 year of daily bars
+    python3 mock_api_server.py --no-compression         # ignore Accept-Encoding
+    python3 mock_api_server.py --record                 # proxy to the real APIs and save the responses
+"""
+
+import argparse
+import copy
+import datetime
+import gzip
+import json
+import os
+import random
+import re
+import threading
+import time
+import urllib.error
+import urllib.parse
+import urllib.request
+import zlib
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+FIXTURES_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), "fixtures")
+
+CLOCKIFY_UPSTREAM = "https://api.clockify.me"
+FMP_UPSTREAM = "https://financialmodelingprep.com"
+
+# (method, path regex, fixture name); the path is matched without the query string
+ROUTES = [
+    ("GET", r"^/api/v1/user$", "clockify_user"),
+    ("GET", r"^/api/v1/workspaces/[^/]+/user/[^/]+/time-entries$", "clockify_time_entries"),
+    ("PATCH", r"^/api/v1/workspaces/[^/]+/user/[^/]+/time-entries$", "clockify_stop_entry"),
+    ("POST", r"^/api/v1/workspaces/[^/]+/user/[^/]+/time-entries$", "clockify_create_entry"),
+    ("GET", r"^/stable/historical-price-eod/full$", "fmp_historical_price_eod_full"),
+    ("GET", r"^/stable/batch-quote$", "fmp_batch_quote"),
+]
+
+
+def load_fixture(name):
+    with open(os.path.join(FIXTURES_DIR, name + ".json"), encoding="utf-8") as f:
+        return json.load(f)
+
+
+def save_fixture(name, body):
+    path = os.path.join(FIXTURES_DIR, name + ".json")
+    try:
+        payload = json.loads(body)
+    except ValueError:
+        print(f"record: {name} is not JSON, not saved")
+        return
+    with open(path, "w", encoding="utf-8") as f:
+        json.dump(payload, f, indent=2)
+        f.write("\n")
+    print(f"record: saved {path}")
+
+
+def utc_now_str():
+    return datetime.datetime.now(datetime.timezone.utc).strftime("%Y-%m-%dT%H:%M:%SZ")
+
+
+def duration_str(start, end):
+    fmt = "%Y-%m-%dT%H:%M:%SZ"
+    seconds = int((datetime.datetime.strptime(end, fmt) - datetime.datetime.strptime(start, fmt)).total_seconds())
+    return f"PT{seconds // 3600}H{seconds % 3600 // 60}M{seconds % 60}S"
+
+
+class MockState:
+    """Mutable Clockify state, so start/stop from the device behaves like the real API."""
+
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.entries = load_fixture("clockify_time_entries")
+        self.in_progress = load_fixture("clockify_time_entries_in_progress")
+        self.next_id = 1
+
+    def time_entries(self, query):
+        page_size = int(query.get("page-size", ["50"])[0])
+        with self.lock:
+            if query.get("in-progress", ["false"])[0] == "true":
+                return copy.deepcopy(self.in_progress[:page_size])
+            entries = self.entries
+            if "start" in query:
+                entries = [e for e in entries if e["timeInterval"]["start"] >= query["start"][0]]
+            return copy.deepcopy(entries[:page_size])
+
+    def stop(self, body):
+        with self.lock:
+            if not self.in_progress:
+                return 404, {"message": "No in progress time entry", "code": 404}
+            entry = self.in_progress.pop(0)
+            entry["timeInterval"]["end"] = body.get("end", utc_now_str())
+            entry["timeInterval"]["duration"] = duration_str(entry["timeInterval"]["start"], entry["timeInterval"]["end"])
+            self.entries.insert(0, entry)
+            return 200, entry
+
+    def create(self, body):
+        with self.lock:
+            if self.in_progress:
+                return 400, {"message": "Time entry already in progress", "code": 501}
+            entry = {
+                "id": f"mock{self.next_id:020d}",
+                "description": body.get("description", ""),
+                "projectId": body.get("projectId"),
+                "type": body.get("type", "REGULAR"),
+                "timeInterval": {"start": body.get("start", utc_now_str()), "end": None, "duration": None},
+            }
+            self.next_id += 1
+            self.in_progress.append(entry)
+            return 201, entry
+
+
+def scale_bars(bars, scale):
+    """Extend the daily bar history backwards `scale` times, keeping the shape of the recorded data."""
+    if scale <= 1 or not bars:
+        return bars
+    scaled = list(bars)
+    oldest = datetime.date.fromisoformat(bars[-1]["date"])
+    for _ in range(scale - 1):
+        for bar in bars:
+            oldest -= datetime.timedelta(days=1)
+            while oldest.weekday() >= 5:
+                oldest -= datetime.timedelta(days=1)
+            copy_bar = dict(bar)
+            copy_bar["date"] = oldest.isoformat()
+            scaled.append(copy_bar)
+    return scaled
+
+
+def batch_quotes(recorded, query):
+    """The recorded quotes of the requested symbols, symbols without a recording copy the first one."""
+    by_symbol = {quote["symbol"]: quote for quote in recorded}
+    symbols = [s for s in query.get("symbols", [""])[0].upper().split(",") if s]
+    return [by_symbol.get(symbol) or dict(recorded[0], symbol=symbol, name=f"{symbol} (mock)") for symbol in symbols]
+
+
+class MockApiHandler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+    options = None
+    state = None
+
+    def log_message(self, fmt, *args):
+        if not self.options.quiet:
+            super().log_message(fmt, *args)
+
+    def do_GET(self):
+        self.handle_request("GET")
+
+    def do_POST(self):
+        self.handle_request("POST")
+
+    def do_PATCH(self):
+        self.handle_request("PATCH")
+
+    def read_body(self):
+        length = int(self.headers.get("Content-Length", 0))
+        return self.rfile.read(length) if length > 0 else b""
+
+    def handle_request(self, method):
+        started = time.monotonic()
+        url = urllib.parse.urlsplit(self.path)
+        query = urllib.parse.parse_qs(url.query)
+        body = self.read_body()
+
+        route = next((r for r in ROUTES if r[0] == method and re.match(r[1], url.path)), None)
+        if route is None:
+            self.send_json(404, {"message": f"No mock route for {method} {url.path}"}, started)
+            return
+
+        if self.options.error_rate > 0 and random.random() < self.options.error_rate:
+            if self.options.error_code == 0:
+                # Simulate a dropped connection instead of an HTTP error
+                self.close_connection = True
+                return
+            self.send_json(self.options.error_code, {"message": "Injected error"}, started)
+            return
+
+        if self.options.record:
+            self.proxy(method, url, body, route[2], started)
+            return
+
+        status, payload = self.replay(route[2], query, body)
+        self.send_json(status, payload, started)
+
+    def replay(self, fixture, query, body):
+        request = json.loads(body) if body else {}
+        if fixture == "clockify_user":
+            return 200, load_fixture(fixture)
+        if fixture == "clockify_time_entries":
+            return 200, self.state.time_entries(query)
+        if fixture == "clockify_stop_entry":
+            return self.state.stop(request)
+        if fixture == "clockify_create_entry":
+            return self.state.create(request)
+        if fixture == "fmp_batch_quote":
+            return 200, batch_quotes(load_fixture(fixture), query)
+        bars = scale_bars(load_fixture(fixture), self.options.scale)
+        if "from" in query:
+            bars = [bar for bar in bars if bar["date"] >= query["from"][0]]
+        symbol = query.get("symbol", [None])[0]
+        if symbol:
+            bars = [dict(bar, symbol=symbol) for bar in bars]
+        return 200, bars
+
+    def proxy(self, method, url, body, fixture, started):
+        upstream = CLOCKIFY_UPSTREAM if url.path.startswith("/api/") else FMP_UPSTREAM
+        headers = {k: v for k, v in self.headers.items() if k.lower() in ("x-api-key", "content-type", "accept")}
+        request = urllib.request.Request(upstream + self.path, data=body or None, method=method, headers=headers)
+        try:
+            with urllib.request.urlopen(request, timeout=30) as response:
+                status, payload = response.status, response.read()
+        except urllib.error.HTTPError as error:
+            status, payload = error.code, error.read()
+        except urllib.error.URLError as error:
+            self.send_json(502, {"message": str(error.reason)}, started)
+            return
+
+        if 200 <= status < 300:
+            if fixture == "clockify_time_entries" and "true" in urllib.parse.parse_qs(url.query).get("in-progress", []):
+                fixture = "clockify_time_entries_in_progress"
+            save_fixture(fixture, payload)
+        self.send_bytes(status, payload, started)
+
+    def send_json(self, status, payload, started):
+        self.send_bytes(status, json.dumps(payload).encode("utf-8"), started)
+
+    def send_bytes(self, status, payload, started):
+        # Injected latency is the time to the first byte, measured from the request arrival
+        latency = self.options.latency_ms + random.uniform(0, self.options.jitter_ms)
+        remaining = latency / 1000.0 - (time.monotonic() - started)
+        if remaining > 0:
+            time.sleep(remaining)
+
+        encoding = self.negotiate_encoding()
+        if encoding == "gzip":
+            payload = gzip.compress(payload)
+        elif encoding == "deflate":
+            payload = zlib.compress(payload)
+
+        self.send_response(status)
+        self.send_header("Content-Type", "application/json")
+        if encoding:
+            self.send_header("Content-Encoding", encoding)
+        self.send_header("Content-Length", str(len(payload)))
+        self.end_headers()
+
+        if self.options.bandwidth <= 0:
+            self.wfile.write(payload)
+            return
+        chunk_size = 512
+        for offset in range(0, len(payload), chunk_size):
+            chunk = payload[offset:offset + chunk_size]
+            self.wfile.write(chunk)
+            self.wfile.flush()
+            time.sleep(len(chunk) / self.options.bandwidth)
+
+    def negotiate_encoding(self):
+        if self.options.no_compression:
+            return None
+        accepted = [e.split(";")[0].strip().lower() for e in self.headers.get("Accept-Encoding", "").split(",")]
+        return next((e for e in ("gzip", "deflate") if e in accepted), None)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--host", default="0.0.0.0")
+    parser.add_argument("--port", type=int, default=8080)
+    parser.add_argument("--latency-ms", type=float, default=0, help="time to first byte added to every response")
+    parser.add_argument("--jitter-ms", type=float, default=0, help="random extra latency, 0..jitter")
+    parser.add_argument("--bandwidth", type=float, default=0, help="response body rate limit in bytes/s, 0 = unlimited")
+    parser.add_argument("--error-rate", type=float, default=0, help="fraction of requests answered with --error-code")
+    parser.add_argument("--error-code", type=int, default=503, help="injected HTTP status, 0 drops the connection")
+    parser.add_argument("--scale", type=int, default=1, help="repeat the recorded stock history this many times")
+    parser.add_argument("--seed", type=int, default=None, help="random seed for repeatable error and jitter injection")
+    parser.add_argument("--no-compression", action="store_true", help="always send identity bodies, ignoring Accept-Encoding")
+    parser.add_argument("--record", action="store_true", help="proxy to the real APIs and overwrite the fixtures")
+    parser.add_argument("--quiet", action="store_true")
+    options = parser.parse_args()
+
+    random.seed(options.seed)
+    MockApiHandler.options = options
+    MockApiHandler.state = MockState()
+    server = ThreadingHTTPServer((options.host, options.port), MockApiHandler)
+    mode = "recording" if options.record else "replaying"
+    print(f"Mock API {mode} on http://{options.host}:{options.port}")
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
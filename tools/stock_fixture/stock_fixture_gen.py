@@ -0,0 +1,109 @@
+#!/usr/bin/env python3
+"""Decodes the recorded FMP stock payloads into the fixture data source of the firmware.
+
+Reads the daily bars and the batch quote of tools/mock_api/fixtures (or other
+recordings) and writes them as constant C++ arrays, so the fixture data source
+(files/stock_data_source.cpp) serves them from flash without parsing any JSON
+on the device. Run it again after re-recording the fixtures with
+mock_api_server.py --record.
+
+Example:
+    python3 tools/stock_fixture/stock_fixture_gen.py
+"""
+
+import argparse
+import datetime
+import json
+import os
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "..")
+FIXTURES = os.path.join(ROOT, "tools", "mock_api", "fixtures")
+
+
+def epoch_day(date):
+    return (datetime.date.fromisoformat(date) - datetime.date(1970, 1, 1)).days
+
+
+def c_string(text):
+    return json.dumps(text, ensure_ascii=True)
+
+
+def c_float(value):
+    return repr(float(value)) + "f"
+
+
+def generate(bars_path, quotes_path):
+    with open(bars_path) as f:
+        entries = json.load(f)
+    with open(quotes_path) as f:
+        quotes = {quote["symbol"]: quote for quote in json.load(f)}
+
+    bars_by_symbol = {}
+    for entry in entries:
+        if entry.get("date"):
+            bars_by_symbol.setdefault(entry["symbol"], []).append(entry)
+
+    lines = [
+        "// Generated by tools/stock_fixture/stock_fixture_gen.py from %s and %s, do not edit"
+        % (os.path.basename(bars_path), os.path.basename(quotes_path)),
+        "#pragma once",
+        "",
+        '#include "stock_data_source.h"',
+        "",
+    ]
+    fixtures = []
+    for symbol, bars in sorted(bars_by_symbol.items()):
+        # Newest first like the api, the series merge sorts them
+        bars.sort(key=lambda bar: bar["date"], reverse=True)
+        array = "STOCK_FIXTURE_BARS_%s" % "".join(c if c.isalnum() else "_" for c in symbol.upper())
+        lines.append("const stock_bar %s[] = {" % array)
+        for bar in bars:
+            lines.append(
+                "    {%d, %s, %s, %s, %s, %du},"
+                % (
+                    epoch_day(bar["date"]),
+                    c_float(bar.get("open", 0)),
+                    c_float(bar.get("close", 0)),
+                    c_float(bar.get("high", 0)),
+                    c_float(bar.get("low", 0)),
+                    int(bar.get("volume", 0)),
+                )
+            )
+        lines.append("};")
+        lines.append("")
+        quote = quotes.get(symbol, {})
+        fixtures.append(
+            "    {%s, %s, %s, sizeof(%s) / sizeof(stock_bar), {%s, %s, %s, %d, 0}},"
+            % (
+                c_string(symbol),
+                c_string(quote.get("name", symbol)),
+                array,
+                array,
+                c_float(quote.get("price", bars[0].get("close", 0))),
+                c_float(quote.get("change", 0)),
+                c_float(quote.get("changePercentage", 0)),
+                quote.get("timestamp", 0) // (24 * 60 * 60) or epoch_day(bars[0]["date"]),
+            )
+        )
+
+    lines.append("const stock_fixture STOCK_FIXTURES[] = {")
+    lines.extend(fixtures)
+    lines.append("};")
+    return "\n".join(lines) + "\n"
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--bars", default=os.path.join(FIXTURES, "fmp_historical_price_eod_full.json"))
+    parser.add_argument("--quotes", default=os.path.join(FIXTURES, "fmp_batch_quote.json"))
+    parser.add_argument("--output", default=os.path.join(ROOT, "files", "stock_fixture_data.h"))
+    args = parser.parse_args()
+
+    header = generate(args.bars, args.quotes)
+    with open(args.output, "w") as f:
+        f.write(header)
+    print("wrote %s" % os.path.normpath(args.output))
+
+
+if __name__ == "__main__":
+    main()